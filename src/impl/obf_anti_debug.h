@@ -167,26 +167,22 @@ namespace ithare { namespace obf {
 #elif defined(_MSC_VER)
 #pragma message("No naive anti-debug for this platform yet, executable will work but without naive anti-debug")
 #endif
-	// defaulting to simple read-volatile (to make sure that literal usages are still not easily eliminatable)  
+	// defaulting to opaque zero (to make sure that literal usages are still not easily eliminatable)  
+	//   used to be read-volatile, but obf_opaque() does the same without a memory load on each use
 
 	template<class Dummy>
 	struct ObfNaiveSystemSpecific {
-		static volatile uint32_t zero;
-		
 		ITHARE_KSCOPE_FORCEINLINE static void init() {//TODO/decide: ?should we obfuscate this function itself?
 		}
 		ITHARE_KSCOPE_FORCEINLINE static uint8_t zero_if_not_being_debugged() {
 #ifdef ITHARE_OBF_DBG_ANTI_DEBUG_ALWAYS_FALSE
 			return 0;
 #else
-			return zero;
+			return obf_opaque_zero<uint8_t>();
 #endif
 		} 
 	};
 	
-	template<class Dummy>
-	volatile uint32_t ObfNaiveSystemSpecific<Dummy>::zero = 0;
-	
 #endif // unrecognized platform		
 
 /* ************** TIME-BASED **************** */
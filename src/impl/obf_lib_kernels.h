@@ -0,0 +1,230 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_lib_kernels_h_included
+#define ithare_obf_lib_kernels_h_included
+
+//NOT intended to be #included directly
+//  #include ../obf_lib.h instead
+//  (the only exception being code which needs non-obfuscated fast paths without obf_lib.h's per-call obfuscation)
+
+#include <string.h>
+#include <assert.h>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include "../obf.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ITHARE_OBF_LIB_SSE2
+#endif
+
+ITHARE_OBF_DEBUG_PERF_PUSH
+namespace ithare { namespace obf {
+
+	//obf_plain(x): decoding OBFI?(T) (or returning plain T as is)
+	template<class ObfT>
+	ITHARE_KSCOPE_FORCEINLINE constexpr typename ObfSizeofReport<ObfT>::plain_type obf_plain(const ObfT& x) {
+		return typename ObfSizeofReport<ObfT>::plain_type(x);
+	}
+
+	//obf_shares_encoding<T,T2>: whether arrays of T and T2 can be compared directly in encoded domain
+	//  same type means same injection (same seed), and no padding means that equal values have equal object representations
+	template<class T, class T2>
+	constexpr bool obf_shares_encoding = std::is_same<T,T2>::value && std::is_trivially_copyable<T>::value && 
+		std::has_unique_object_representations<T>::value;
+
+	//CONSTANT-TIME COMPARISONS
+	//  no early exits and no data-dependent branches: run time depends only on size, but not on contents (nor on position of the first difference)
+	//  NB: constant-time-ness of lane-wise versions relies on surjections being branch-free (which holds for all our injections)
+
+	//obf_ct_equal_bytes(): raw bytes, 16 bytes per iteration with SSE2, 8 bytes per iteration otherwise
+	inline bool obf_ct_equal_bytes(const void* a, const void* b, size_t n) {
+		const uint8_t* pa = reinterpret_cast<const uint8_t*>(a);
+		const uint8_t* pb = reinterpret_cast<const uint8_t*>(b);
+		uint64_t acc = 0;
+		size_t i = 0;
+#ifdef ITHARE_OBF_LIB_SSE2
+		__m128i acc128 = _mm_setzero_si128();
+		for (; i + 16 <= n; i += 16)
+			acc128 = _mm_or_si128(acc128, _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i))));
+		alignas(16) uint64_t lanes[2];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc128);
+		acc = lanes[0] | lanes[1];
+#endif
+		for (; i + 8 <= n; i += 8) {
+			uint64_t wa, wb;
+			memcpy(&wa, pa + i, 8);
+			memcpy(&wb, pb + i, 8);
+			acc |= wa ^ wb;
+		}
+		for (; i < n; ++i)
+			acc |= uint64_t(pa[i] ^ pb[i]);
+		return obf_opaque(acc) == 0;//obf_opaque() to prevent the compiler from turning the whole thing into early-exit loop
+	}
+
+	//obf_ct_equal_lanes(): element-wise transcoding into plain domain; used when encodings differ
+	template<class T, class T2>
+	bool obf_ct_equal_lanes(const T* a, const T2* b, size_t n) {
+		uint64_t acc = 0;
+		for (size_t i = 0; i < n; ++i)
+			acc |= uint64_t(obf_plain(a[i])) ^ uint64_t(obf_plain(b[i]));
+		return obf_opaque(acc) == 0;
+	}
+
+	template<class T, class T2>
+	ITHARE_KSCOPE_FORCEINLINE bool obf_ct_equal(const T* a, const T2* b, size_t n) {
+		if constexpr(obf_shares_encoding<T,T2>)
+			return obf_ct_equal_bytes(a, b, n * sizeof(T));
+		else
+			return obf_ct_equal_lanes(a, b, n);
+	}
+
+	//obf_ct_compare(): memcmp()-like lexicographical comparison of plain values; returns -1, 0, or 1
+	//  encoded domain doesn't preserve order, so it is always lane-wise
+	template<class T, class T2>
+	int obf_ct_compare(const T* a, const T2* b, size_t n) {
+		int32_t ret = 0;
+		uint32_t decided = 0;//0 or 1
+		for (size_t i = 0; i < n; ++i) {
+			auto x = obf_plain(a[i]);
+			auto y = obf_plain(b[i]);
+			int32_t d = int32_t(x > y) - int32_t(x < y);
+			ret |= d & int32_t(decided - 1);//decided-1 is all-ones while still undecided
+			decided |= uint32_t(d) & 1;
+		}
+		return obf_opaque(ret);
+	}
+
+	//ALGORITHMS
+	//  whenever possible, working in encoded domain (encoding value once, then comparing/copying encoded representations,
+	//    which compiles into the same vectorizable loops as for plain types);
+	//  otherwise (accumulate/minmax have to see plain values) - lane-wise surjection, which is branch-free and vectorizes as long as the injection does 
+
+	//ObfReprType<T>: unsigned integer holding object representation of T (void if there is no such integer)
+	template<size_t sz> struct ObfReprTypeHelper { using type = void; };
+	template<> struct ObfReprTypeHelper<1> { using type = uint8_t; };
+	template<> struct ObfReprTypeHelper<2> { using type = uint16_t; };
+	template<> struct ObfReprTypeHelper<4> { using type = uint32_t; };
+	template<> struct ObfReprTypeHelper<8> { using type = uint64_t; };
+	template<class T>
+	using ObfReprType = typename ObfReprTypeHelper<sizeof(T)>::type;
+
+	template<class T>
+	constexpr bool obf_has_repr = obf_shares_encoding<T,T> && !std::is_void<ObfReprType<T>>::value;
+
+	template<class T>
+	ITHARE_KSCOPE_FORCEINLINE ObfReprType<T> obf_repr(const T& x) {
+		ObfReprType<T> ret;
+		memcpy(&ret, &x, sizeof(T));
+		return ret;
+	}
+
+	template<class T, class T2>
+	void obf_fill_n(T* to, size_t n, const T2& value) {
+		T enc = value;//encoding once; then it is merely a copy of encoded representation
+		for (size_t i = 0; i < n; ++i)
+			to[i] = enc;
+	}
+
+	template<class T, class T2>
+	size_t obf_find_n(const T* a, size_t n, const T2& value) {//returns n if not found
+		if constexpr(obf_has_repr<T>) {
+			T enc = value;
+			ObfReprType<T> needle = obf_repr(enc);
+			for (size_t i = 0; i < n; ++i)
+				if (obf_repr(a[i]) == needle)
+					return i;
+		}
+		else {
+			auto needle = obf_plain(value);
+			for (size_t i = 0; i < n; ++i)
+				if (obf_plain(a[i]) == needle)
+					return i;
+		}
+		return n;
+	}
+
+	template<class T, class T2>
+	size_t obf_count_n(const T* a, size_t n, const T2& value) {
+		size_t ret = 0;
+		if constexpr(obf_has_repr<T>) {
+			T enc = value;
+			ObfReprType<T> needle = obf_repr(enc);
+			for (size_t i = 0; i < n; ++i)
+				ret += obf_repr(a[i]) == needle;
+		}
+		else {
+			auto needle = obf_plain(value);
+			for (size_t i = 0; i < n; ++i)
+				ret += obf_plain(a[i]) == needle;
+		}
+		return ret;
+	}
+
+	template<class T, class Acc>
+	Acc obf_accumulate_n(const T* a, size_t n, Acc init) {
+		for (size_t i = 0; i < n; ++i)
+			init += obf_plain(a[i]);
+		return init;
+	}
+
+	template<class T>
+	std::pair<typename ObfSizeofReport<T>::plain_type, typename ObfSizeofReport<T>::plain_type> obf_minmax_n(const T* a, size_t n) {
+		assert(n > 0);
+		auto mn = obf_plain(a[0]);
+		auto mx = mn;
+		for (size_t i = 1; i < n; ++i) {
+			auto x = obf_plain(a[i]);
+			mn = x < mn ? x : mn;//ternaries rather than ifs - to allow for min/max instructions 
+			mx = x > mx ? x : mx;
+		}
+		return std::pair(mn, mx);
+	}
+
+	template<class T>
+	void obf_reverse_n(T* a, size_t n) {//pure permutation; encoded values are moved as is, so std::reverse() is as good as it gets
+		std::reverse(a, a + n);
+	}
+
+	//obf_transcode_n(): re-encoding from one OBFI?() type into another (or from/to plain)
+	//  decoded value lives only in register between surjection and injection
+	template<class From, class To>
+	void obf_transcode_n(const From* from, To* to, size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			to[i] = obf_plain(from[i]);
+	}
+
+}}//namespace ithare::obf
+ITHARE_OBF_DEBUG_PERF_POP
+
+#endif //ithare_obf_lib_kernels_h_included
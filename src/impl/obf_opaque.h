@@ -0,0 +1,77 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_opaque_h_included
+#define ithare_obf_opaque_h_included
+
+//NOT intended to be #included directly
+//  #include ../obf.h instead
+
+#include <type_traits>
+
+namespace ithare { namespace obf {
+
+	//obf_opaque(x) returns x, but hides it from the optimizer, so the compiler can neither fold it nor eliminate the code using it
+	//  unlike reading a volatile or going through aliased pointers, it doesn't cause any memory traffic - 
+	//  the value stays in register, and the only cost is a possible extra mov
+	//  on compilers without GCC-style inline asm (in particular, on MSVC/x64) falls back to reading volatile  
+#if defined(__clang__) || defined(__GNUC__)
+	template<class T>
+	ITHARE_KSCOPE_FORCEINLINE T obf_opaque(T x) {
+		static_assert(std::is_integral<T>::value);
+		__asm__("" : "+r"(x));//empty asm; no 'volatile' - if the result is not used, it MAY be eliminated
+		return x;
+	}
+#else
+	//moving globals into header (along the lines of https://stackoverflow.com/a/27070265)
+	template<class Dummy>
+	struct ObfOpaqueStaticData {
+		static volatile uint8_t zero;
+	};
+	template<class Dummy>
+	volatile uint8_t ObfOpaqueStaticData<Dummy>::zero = 0;
+
+	template<class T>
+	ITHARE_KSCOPE_FORCEINLINE T obf_opaque(T x) {
+		static_assert(std::is_integral<T>::value);
+		return x + T(ObfOpaqueStaticData<void>::zero);
+	}
+#endif
+
+	template<class T>
+	ITHARE_KSCOPE_FORCEINLINE T obf_opaque_zero() {
+		return obf_opaque(T(0));
+	}
+
+}}//namespace ithare::obf
+
+#endif //ithare_obf_opaque_h_included
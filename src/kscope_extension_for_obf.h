@@ -41,6 +41,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../kscope/src/impl/kscope_injection.h"
 #include "../../kscope/src/impl/kscope_literal.h"
 #include "../../kscope/src/impl/kscope_context.h"
+#include "impl/obf_opaque.h"
 #include "impl/obf_anti_debug.h"
 
 #ifdef ITHARE_KSCOPE_SEED
@@ -476,11 +477,47 @@ namespace ithare { namespace kscope {//cannot really move it to ithare::obf due
 	alignas(obf_cache_line_size) typename KscopeLiteralContextVersion<ITHARE_KSCOPE_LAST_STOCK_LITERAL+4, T, seed>::StaticData KscopeLiteralContextVersion<ITHARE_KSCOPE_LAST_STOCK_LITERAL+4, T, seed>::statdata = {CC0};
 	
 
+	//version last+5: opaque constant
+	//  register-only counterpart of last+1: hides the value from the optimizer via obf_opaque(), without any memory traffic
+	//  last+1 is still kept, as a call with aliased pointers is a (more expensive) obfuscation on its own 
+	template<class T>
+	struct ObfLiteralAdditionalVersion5Descr {//NB: to ensure 100%-compatible generation across platforms, probabilities MUST NOT depend on the platform, directly or indirectly
+		static constexpr KscopeDescriptor descr = 
+			KscopeTraits<T>::is_built_in ? //obf_opaque() works only for integral types 
+			KscopeDescriptor(3, 100)
+			: KscopeDescriptor(nullptr);
+	};
+
+	template<class T, ITHARE_KSCOPE_SEEDTPARAM seed>
+	struct KscopeLiteralContextVersion<ITHARE_KSCOPE_LAST_STOCK_LITERAL+5,T,seed> {
+		using Traits = KscopeTraits<T>;
+		constexpr static KSCOPECYCLES context_cycles = ObfLiteralAdditionalVersion5Descr<T>::descr.min_cycles;
+
+		constexpr static T CC = obf_random_const<T,ITHARE_KSCOPE_NEW_PRNG(seed, 1),0>();
+		template<ITHARE_KSCOPE_SEEDTPARAM seed2,KSCOPEFLAGS flags>
+		ITHARE_KSCOPE_FORCEINLINE static constexpr T final_injection(T x) {
+			return x + CC;
+		}
+		template<ITHARE_KSCOPE_SEEDTPARAM seed2,KSCOPEFLAGS flags>
+		ITHARE_KSCOPE_FORCEINLINE static constexpr T final_surjection(T y) {
+			if constexpr(flags&kscope_flag_is_constexpr)
+				return y - CC;
+			else
+				return y - ithare::obf::obf_opaque(CC);
+		}
+#ifdef ITHARE_KSCOPE_DBG_ENABLE_DBGPRINT
+		static void dbg_print(size_t offset = 0, const char* prefix = "") {
+			std::cout << std::string(offset, ' ') << prefix << "KscopeLiteralContextVersion<ITHARE_KSCOPE_LAST_STOCK_LITERAL+5="<< (ITHARE_KSCOPE_LAST_STOCK_LITERAL+5) <<"/*opaque constant*/," << kscope_dbg_print_t<T>() << "," << kscope_dbg_print_seed<seed>() << ">: CC=" << kscope_dbg_print_c<T>(CC) << std::endl;
+		}
+#endif
+	};
+
 #define ITHARE_KSCOPE_ADDITIONAL_LITERAL_DESCRIPTOR_LIST \
 	ObfLiteralAdditionalVersion1Descr::descr,\
 	ObfLiteralAdditionalVersion2Descr::descr,\
 	ObfLiteralAdditionalVersion3Descr::descr,\
-	ObfLiteralAdditionalVersion4Descr<T>::descr
+	ObfLiteralAdditionalVersion4Descr<T>::descr,\
+	ObfLiteralAdditionalVersion5Descr<T>::descr
 		
 	template<class T>
 	struct ObfZeroLiteralContext : public KscopeZeroLiteralContext<T> {
@@ -508,6 +545,19 @@ namespace ithare { namespace kscope {//cannot really move it to ithare::obf due
 		};
 	#define ITHARE_KSCOPE_INTVAR_CONTEXT ObfIntVarContext
 
+	//compact mode: restricting injections of obfuscated variables to bijections, 
+	//  so that sizeof(OBFI?(T)) == sizeof(T) (and arrays of obfuscated structs have the same cache density as plain ones)
+	//  NB: restricts the choice of injections => somewhat weaker obfuscation  
+	//  NB: relies on kscope using ITHARE_KSCOPE_INTVAR_INJECTION_REQUIREMENTS (when defined) as requirements for root injection of KscopeInt<>;
+	//      with a kscope which doesn't, ObfCompactCheck<> in obf.h fails the build on the first non-compact OBFI?() type
+	struct ObfCompactInjectionRequirements {
+		static constexpr size_t exclude_version = size_t(-1);
+		static constexpr bool only_bijections = true;
+	};
+#ifdef ITHARE_OBF_COMPACT
+	#define ITHARE_KSCOPE_INTVAR_INJECTION_REQUIREMENTS ObfCompactInjectionRequirements
+#endif
+
 	template<class T>
 	struct ObfExtendedLiteralContextDescr {
 		constexpr static KscopeDescriptor descr[] = {
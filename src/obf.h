@@ -55,14 +55,20 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //   ITHARE_OBF_NO_AUTO_INIT (disables automated call to obf_init() via constructor, so you can call it manually, 
 //							  ensuring proper order of initialization. Wrong order of calls shouldn't crash the program, 
 //							  but some anti-debug protections may be disabled before obf_init() is called)
+//   ITHARE_OBF_COMPACT (restricts obfuscated variables to bijective injections, guaranteeing sizeof(OBFI?(T))==sizeof(T);
+//                       each OBFI?() type is static_assert-ed to be compact; see also ObfSizeofReport<> below)
 //   ITHARE_OBF_NO_SHORT_DEFINES (define to avoid polluting macro name space with short OBFI*() etc. macros 
 //								  - and use full ITHARE_OBF_INT*() etc. macros instead)
+//   ITHARE_OBF_DEBUG_PERF (for -O0/-Og builds with ITHARE_OBF_SEED, e.g. for QA; same encodings, 
+//                          but kscope/obf internals are compiled as optimized code - see ITHARE_OBF_DEBUG_PERF_PUSH below)
 //
 // DEBUG-ONLY; MUST NOT be used in production
 //   ITHARE_OBF_COMPILE_TIME_TESTS
 //   ITHARE_OBF_DBG_ENABLE_DBGPRINT
 //   ITHARE_OBF_DBG_RUNTIME_CHECKS
 //   ITHARE_OBF_DBG_ANTI_DEBUG_ALWAYS_FALSE (to disable anti-debug - use ITHARE_OBF_NO_ANTI_DEBUG or 
+//   ITHARE_OBF_DBG_MCA_MARKERS (makes ITHARE_OBF_MCA_BEGIN()/ITHARE_OBF_MCA_END() emit llvm-mca region markers 
+//                               into generated assembly; see ../test/obfmcaaudit.cpp)
 
 //ithare::obf naming conventions are the same as those of kscope, in particular: 
 //  functions: 
@@ -106,12 +112,50 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ITHARE_KSCOPE_COMPILE_TIME_TESTS ITHARE_OBF_COMPILE_TIME_TESTS
 #endif
 
+//ITHARE_OBF_DEBUG_PERF_PUSH/ITHARE_OBF_DEBUG_PERF_POP: bracket headers with obfuscation internals
+//  at -O0, FORCEINLINE template recursion is still inlined, but nothing in the resulting code is optimized, 
+//    and non-FORCEINLINE helpers become real calls, which makes obfuscated -O0 builds 20-50x slower than plain ones
+//  with ITHARE_OBF_DEBUG_PERF under GCC, all functions (including templates) declared between PUSH and POP are compiled with -O2, 
+//    while user code keeps the command-line level and stays debuggable
+//  Clang has no way to raise optimization level per function; for Clang (and as an addition for GCC), 
+//    mark hot user functions with ITHARE_OBF_DEBUG_FLATTEN. For MSVC, add /Ob1 to /Od so that __forceinline is honored 
+#if defined(ITHARE_OBF_DEBUG_PERF) && defined(__GNUC__) && !defined(__clang__)
+#define ITHARE_OBF_DEBUG_PERF_PUSH _Pragma("GCC push_options") _Pragma("GCC optimize(\"O2\")")
+#define ITHARE_OBF_DEBUG_PERF_POP _Pragma("GCC pop_options")
+#else
+#define ITHARE_OBF_DEBUG_PERF_PUSH
+#define ITHARE_OBF_DEBUG_PERF_POP
+#endif
+#if defined(ITHARE_OBF_DEBUG_PERF) && (defined(__GNUC__) || defined(__clang__))
+#define ITHARE_OBF_DEBUG_FLATTEN __attribute__((flatten))
+#else
+#define ITHARE_OBF_DEBUG_FLATTEN
+#endif
+
+ITHARE_OBF_DEBUG_PERF_PUSH
 #include "kscope_extension_for_obf.h"
 #include "../../kscope/src/kscope.h"
+ITHARE_OBF_DEBUG_PERF_POP
+#include <string>
 
 #define ITHARE_OBF_FORCEINLINE ITHARE_KSCOPE_FORCEINLINE
 #define ITHARE_OBF_NOINLINE ITHARE_KSCOPE_NOINLINE
+#if defined(__clang__) || defined(__GNUC__)
+#define ITHARE_OBF_COLD __attribute__((noinline,cold))
+#else
+#define ITHARE_OBF_COLD ITHARE_KSCOPE_NOINLINE
+#endif
 
+#ifdef ITHARE_OBF_COMPACT
+//compact build: each OBFI?() type is static_assert-ed to be compact (see ObfCompactCheck<> below)
+#define ITHARE_OBF_INT0(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT0(__VA_ARGS__)>
+#define ITHARE_OBF_INT1(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT1(__VA_ARGS__)>
+#define ITHARE_OBF_INT2(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT2(__VA_ARGS__)>
+#define ITHARE_OBF_INT3(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT3(__VA_ARGS__)>
+#define ITHARE_OBF_INT4(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT4(__VA_ARGS__)>
+#define ITHARE_OBF_INT5(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT5(__VA_ARGS__)>
+#define ITHARE_OBF_INT6(...) ithare::obf::ObfCompactChecked<ITHARE_KSCOPE_INT6(__VA_ARGS__)>
+#else
 #define ITHARE_OBF_INT0 ITHARE_KSCOPE_INT0
 #define ITHARE_OBF_INT1 ITHARE_KSCOPE_INT1
 #define ITHARE_OBF_INT2 ITHARE_KSCOPE_INT2
@@ -119,6 +163,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ITHARE_OBF_INT4 ITHARE_KSCOPE_INT4
 #define ITHARE_OBF_INT5 ITHARE_KSCOPE_INT5
 #define ITHARE_OBF_INT6 ITHARE_KSCOPE_INT6
+#endif
 
 #define ITHARE_OBF_INTLIT0 ITHARE_KSCOPE_INTLIT0
 #define ITHARE_OBF_INTLIT1 ITHARE_KSCOPE_INTLIT1
@@ -147,6 +192,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ITHARE_OBF_STRLIT5 ITHARE_KSCOPE_STRLIT5
 #define ITHARE_OBF_STRLIT6 ITHARE_KSCOPE_STRLIT6
 
+//STRLIT?_COLD: for literals used only on cold paths (error handling etc.)
+//  decodes literal into std::string within an outlined ITHARE_OBF_COLD function (GCC/Clang place cold functions into .text.unlikely on ELF), 
+//  so the decoder doesn't bloat the hot function which uses it
+//  NB: there is no way to detect [[unlikely]] branches from within the library, so cold usage has to be declared explicitly
+namespace ithare { namespace obf {
+	template<class F>
+	ITHARE_OBF_COLD std::string obf_cold_decode(F f) {//each call site has its own lambda type => its own outlined decoder
+		return std::string(f());
+	}
+}}//namespace ithare::obf
+#define ITHARE_OBF_STRLIT_COLD_HELPER(strlit,s) ithare::obf::obf_cold_decode([]{ return strlit(s); })
+#define ITHARE_OBF_STRLIT0_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT0,s)
+#define ITHARE_OBF_STRLIT1_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT1,s)
+#define ITHARE_OBF_STRLIT2_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT2,s)
+#define ITHARE_OBF_STRLIT3_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT3,s)
+#define ITHARE_OBF_STRLIT4_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT4,s)
+#define ITHARE_OBF_STRLIT5_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT5,s)
+#define ITHARE_OBF_STRLIT6_COLD(s) ITHARE_OBF_STRLIT_COLD_HELPER(ITHARE_OBF_STRLIT6,s)
+
 //#define ITHARE_OBF_INT_CONSTEXPR ITHARE_KSCOPE_INT_CONSTEXPR
 #define ITHARE_OBF_INTNULLPTR ITHARE_KSCOPE_INTNULLPTR 
 
@@ -165,6 +229,102 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define ITHARE_OBF_DBGPRINT ITHARE_KSCOPE_DBGPRINT
 
+namespace ithare { namespace obf {
+	//obf_splitmix64(): SplitMix64 finalizer (applied to x + golden ratio, so obf_splitmix64(seed+i*golden) is the usual SplitMix64 sequence)
+	constexpr uint64_t obf_splitmix64(uint64_t x) {
+		x += UINT64_C(0x9e37'79b9'7f4a'7c15);
+		x = (x ^ (x >> 30)) * UINT64_C(0xbf58'476d'1ce4'e5b9);
+		x = (x ^ (x >> 27)) * UINT64_C(0x94d0'49bb'1331'11eb);
+		return x ^ (x >> 31);
+	}
+
+	//obf_tag_hash(): FNV-1a-64 of a string; used to derive per-type seeds from explicit tags,
+	//  as __LINE__/__COUNTER__ differ between TUs including the same header (=> ODR violation, different layouts/encodings for "the same" type)
+	constexpr uint64_t obf_tag_hash(const char* s) {
+		uint64_t h = UINT64_C(0xcbf2'9ce4'8422'2325);
+		for (const char* p = s; *p; ++p) {
+			h ^= uint8_t(*p);
+			h *= UINT64_C(0x100'0000'01b3);
+		}
+		return h;
+	}
+
+	//obf_mul_inverse(): inverse of odd a modulo 2^N; Newton's iteration, each step doubles number of correct bits 
+	template<class UT>
+	constexpr UT obf_mul_inverse(UT a) {
+		static_assert(std::is_unsigned<UT>::value);
+		using WT = typename std::conditional<(sizeof(UT) < sizeof(unsigned)), unsigned, UT>::type;//avoiding promotion to (overflowing) int
+		WT x = a;
+		for (int i = 0; i < 6; ++i)
+			x *= WT(2) - WT(a) * x;
+		return UT(x);
+	}
+
+	constexpr size_t obf_cache_line = 64;//not std::hardware_destructive_interference_size, as it is not universally available (and causes ABI warnings)
+
+	//ObfSizeofReport<OBFI?(T)>: sizeof() of obfuscated type vs sizeof() of underlying plain type
+	//  is_obf_type: whether ObfT is recognized as obfuscated; with ITHARE_OBF_SEED, it MUST be true for all OBFI?() types 
+	//    (otherwise KscopeInt's template parameters don't match the specialization, and plain_type/is_compact are wrong)
+	template<class ObfT>
+	struct ObfSizeofReport {//non-obfuscated (no ITHARE_OBF_SEED, or plain type)
+		static_assert(std::is_scalar<ObfT>::value,"ObfSizeofReport<>: neither plain scalar nor ithare::kscope::KscopeInt<>; if it is OBFI?(), KscopeInt's template parameters don't match ObfSizeofReport<> specialization");
+		static constexpr bool is_obf_type = false;
+		using plain_type = ObfT;
+		static constexpr size_t plain_size = sizeof(ObfT);
+		static constexpr size_t obf_size = sizeof(ObfT);
+		static constexpr bool is_compact = true;
+	};
+#ifdef ITHARE_KSCOPE_SEED
+	template<class T, ITHARE_KSCOPE_SEEDTPARAM seed, auto cycles>
+	struct ObfSizeofReport<ithare::kscope::KscopeInt<T,seed,cycles>> {
+		static constexpr bool is_obf_type = true;
+		using plain_type = T;
+		static constexpr size_t plain_size = sizeof(T);
+		static constexpr size_t obf_size = sizeof(ithare::kscope::KscopeInt<T,seed,cycles>);
+		static constexpr bool is_compact = obf_size == plain_size;
+	};
+#endif
+
+	//ObfCompactChecked<OBFI?(T)>: OBFI?(T) itself, which MUST be compact
+	//  used by OBFI?() under ITHARE_OBF_COMPACT, so that if kscope doesn't honor ITHARE_KSCOPE_INTVAR_INJECTION_REQUIREMENTS,
+	//  compact build fails instead of silently producing non-compact types
+	template<class ObfT>
+	struct ObfCompactCheck {
+#ifdef ITHARE_KSCOPE_SEED
+		static_assert(ObfSizeofReport<ObfT>::is_obf_type,"OBFI?() type doesn't match ObfSizeofReport<ithare::kscope::KscopeInt<>> specialization");
+#endif
+		static_assert(ObfSizeofReport<ObfT>::is_compact,"ITHARE_OBF_COMPACT: sizeof(obfuscated type) != sizeof(plain type); does kscope honor ITHARE_KSCOPE_INTVAR_INJECTION_REQUIREMENTS?");
+		using type = ObfT;
+	};
+	template<class ObfT>
+	using ObfCompactChecked = typename ObfCompactCheck<ObfT>::type;
+}}//namespace ithare::obf
+#ifdef ITHARE_KSCOPE_SEED
+//the same check for non-compact builds, on one representative type
+static_assert(ithare::obf::ObfSizeofReport<ITHARE_KSCOPE_INT3(uint32_t)>::is_obf_type,"OBFI?() type doesn't match ObfSizeofReport<ithare::kscope::KscopeInt<>> specialization");
+#endif
+
+//ITHARE_OBF_ASSERT_COMPACT(OBFI?(T)) - per-type check for non-compact builds (under ITHARE_OBF_COMPACT, all OBFI?() types are checked anyway)
+#define ITHARE_OBF_ASSERT_COMPACT(...) static_assert(ithare::obf::ObfSizeofReport<__VA_ARGS__>::is_compact,"sizeof(obfuscated type) != sizeof(plain type); consider ITHARE_OBF_COMPACT")
+#ifdef ITHARE_OBF_DBG_ENABLE_DBGPRINT
+#define ITHARE_OBF_DBGPRINT_SIZEOF(...) do { using Report = ithare::obf::ObfSizeofReport<__VA_ARGS__>; std::cout << "sizeof(" #__VA_ARGS__ ")=" << Report::obf_size << " sizeof(plain)=" << Report::plain_size << (Report::is_compact ? "" : " NOT COMPACT") << std::endl; } while(0)
+#else
+#define ITHARE_OBF_DBGPRINT_SIZEOF(...)
+#endif
+
+//ITHARE_OBF_MCA_BEGIN(name,X)/ITHARE_OBF_MCA_END(name): marking an obfuscated site for static cost audit
+//  X is the same as in OBFX(), i.e. the site is expected to cost no more than 10^(X/2) CPU cycles
+//  name MUST be unique across the TU, and marked code SHOULD be within ITHARE_OBF_NOINLINE function
+//    (otherwise the same region may be emitted several times)
+//  markers are asm volatile, so they DO affect code generation a bit; NEVER use ITHARE_OBF_DBG_MCA_MARKERS in production 
+#if defined(ITHARE_OBF_DBG_MCA_MARKERS) && (defined(__clang__) || defined(__GNUC__)) && (defined(__x86_64__)||defined(__i386__))
+#define ITHARE_OBF_MCA_BEGIN(name,X) __asm__ __volatile__("# LLVM-MCA-BEGIN " #name "\n\t# ITHARE-OBF-MCA-BUDGET " #name " " #X)
+#define ITHARE_OBF_MCA_END(name) __asm__ __volatile__("# LLVM-MCA-END " #name)
+#else
+#define ITHARE_OBF_MCA_BEGIN(name,X)
+#define ITHARE_OBF_MCA_END(name)
+#endif
+
 #ifndef ITHARE_OBF_NO_SHORT_DEFINES
 
 #define OBFI0 ITHARE_OBF_INT0
@@ -201,6 +361,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OBFS5L ITHARE_OBF_STRLIT5
 #define OBFS6L ITHARE_OBF_STRLIT6
 
+#define OBFS0L_COLD ITHARE_OBF_STRLIT0_COLD
+#define OBFS1L_COLD ITHARE_OBF_STRLIT1_COLD
+#define OBFS2L_COLD ITHARE_OBF_STRLIT2_COLD
+#define OBFS3L_COLD ITHARE_OBF_STRLIT3_COLD
+#define OBFS4L_COLD ITHARE_OBF_STRLIT4_COLD
+#define OBFS5L_COLD ITHARE_OBF_STRLIT5_COLD
+#define OBFS6L_COLD ITHARE_OBF_STRLIT6_COLD
+
 //#define OBFICE ITHARE_OBF_INT_CONSTEXPR
 #define OBFINULLPTR ITHARE_OBF_INTNULLPTR
 
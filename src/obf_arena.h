@@ -0,0 +1,172 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_arena_h_included
+#define ithare_obf_arena_h_included
+
+//ObfArena: bump allocator for (short-lived) objects with OBFI?() fields, with randomized placement
+//  with malloc(), objects are laid out predictably (by size class and offset), so scanners can find them easily;
+//    ObfArena splits each chunk into stripes (1K by default), and fills stripes in a random order, 
+//    re-shuffled each time a chunk is (re)entered, so the layout changes from frame to frame 
+//  Within a stripe, allocation is a plain bump (objects allocated together stay together, which keeps iteration locality),
+//    and objects no larger than cache line never straddle cache line boundary
+//  reset() is O(1): chunks are kept, and re-shuffling is incremental (one Fisher-Yates swap per stripe entered), 
+//    so each full pass over a chunk still fills its stripes in a uniformly random order
+//  Without ITHARE_OBF_SEED stripes are filled in order (same as all the other obfuscation, randomization is for deployments only);
+//    with ITHARE_OBF_SEED order is seeded with both ITHARE_OBF_SEED and std::random_device (differs from run to run)
+//  NB: destructors are NOT called; create<>() requires trivially destructible types 
+//  NB: requests larger than stripe size, or aligned stricter than cache line, always fail (returning nullptr)
+//  NB: NOT thread-safe; use one arena per thread
+
+#include <vector>
+#include <new>
+#include <random>
+#include <utility>
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+		class ObfArena {
+			struct Chunk {
+				uint8_t* mem;
+				uint16_t* order;//stripe fill order
+			};
+
+			size_t chunk_size;
+			size_t stripe_size;
+			size_t nstripes;
+			std::vector<Chunk> chunks;
+			size_t cur_chunk = 0;
+			size_t cur_stripe = 0;//index within order
+			uint8_t* bump = nullptr;
+			uint8_t* stripe_end = nullptr;
+			uint64_t prng_state = 0;//0 means 'no randomization'
+
+			public:
+			static constexpr size_t default_chunk_size = 1 << 20;
+			static constexpr size_t default_stripe_size = 1024;
+
+			explicit ObfArena(size_t chunk_size_ = default_chunk_size, size_t stripe_size_ = default_stripe_size)
+			: ObfArena(chunk_size_, stripe_size_, default_seed()) {
+			}
+			ObfArena(size_t chunk_size_, size_t stripe_size_, uint64_t seed)//seed == 0 disables randomization
+			: chunk_size(chunk_size_), stripe_size(stripe_size_), nstripes(chunk_size_ / stripe_size_), prng_state(seed) {
+				assert(stripe_size % obf_cache_line == 0);
+				assert(chunk_size % stripe_size == 0);
+				assert(nstripes >= 1 && nstripes <= 65536);
+				enter_chunk(0);
+			}
+			~ObfArena() {
+				for (auto& c : chunks) {
+					::operator delete(c.mem, std::align_val_t(obf_cache_line));
+					delete [] c.order;
+				}
+			}
+			ObfArena(const ObfArena&) = delete;
+			ObfArena& operator =(const ObfArena&) = delete;
+
+			ITHARE_OBF_FORCEINLINE void* allocate(size_t size, size_t align) {//returns nullptr if size > stripe_size or align > obf_cache_line
+				if (align > obf_cache_line)//normally a compile-time constant
+					return nullptr;
+				uint8_t* p = align_up(bump, align);
+				if (size <= obf_cache_line && ((reinterpret_cast<uintptr_t>(p) ^ (reinterpret_cast<uintptr_t>(p) + size - 1)) & ~uintptr_t(obf_cache_line - 1)))
+					p = align_up(p, obf_cache_line);//would straddle cache line
+				if (p + size > stripe_end)
+					return allocate_slow(size, align);
+				bump = p + size;
+				return p;
+			}
+			template<class T, class... Args>
+			T* create(Args&&... args) {
+				static_assert(std::is_trivially_destructible<T>::value, "ObfArena doesn't call destructors");
+				void* p = allocate(sizeof(T), alignof(T));
+				return p ? new(p) T(std::forward<Args>(args)...) : nullptr;
+			}
+			void reset() {//O(1)
+				enter_chunk(0);
+			}
+			size_t nchunks() const {
+				return chunks.size();
+			}
+
+			private:
+			static uint64_t default_seed() {
+#ifdef ITHARE_OBF_SEED
+				std::random_device rd;
+				return obf_splitmix64(uint64_t(ITHARE_OBF_SEED) ^ (uint64_t(rd()) << 32) ^ rd()) | 1;
+#else
+				return 0;
+#endif
+			}
+			static ITHARE_OBF_FORCEINLINE uint8_t* align_up(uint8_t* p, size_t align) {
+				return reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~uintptr_t(align - 1));
+			}
+			uint64_t next_random() {//xorshift64*
+				prng_state ^= prng_state >> 12;
+				prng_state ^= prng_state << 25;
+				prng_state ^= prng_state >> 27;
+				return prng_state * UINT64_C(0x2545'F491'4F6C'DD1D);
+			}
+			void enter_chunk(size_t k) {
+				if (k == chunks.size()) {
+					Chunk c;
+					c.mem = static_cast<uint8_t*>(::operator new(chunk_size, std::align_val_t(obf_cache_line)));
+					c.order = new uint16_t[nstripes];
+					for (size_t i = 0; i < nstripes; ++i)
+						c.order[i] = uint16_t(i);
+					chunks.push_back(c);
+				}
+				cur_chunk = k;
+				enter_stripe(0);
+			}
+			void enter_stripe(size_t s) {
+				uint16_t* order = chunks[cur_chunk].order;
+				if (prng_state)//s-th step of Fisher-Yates on top of previous order: picking s-th stripe out of the ones not used in this pass
+					std::swap(order[s], order[s + next_random() % (nstripes - s)]);
+				cur_stripe = s;
+				bump = chunks[cur_chunk].mem + size_t(chunks[cur_chunk].order[s]) * stripe_size;
+				stripe_end = bump + stripe_size;
+			}
+			ITHARE_OBF_NOINLINE void* allocate_slow(size_t size, size_t align) {
+				if (size > stripe_size)//would never fit, even into a fresh stripe
+					return nullptr;
+				if (cur_stripe + 1 < nstripes)
+					enter_stripe(cur_stripe + 1);
+				else
+					enter_chunk(cur_chunk + 1);
+				return allocate(size, align);//fresh stripe is cache-line-aligned and size <= stripe_size, so it will fit
+			}
+		};
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_arena_h_included
@@ -0,0 +1,269 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_checksum_h_included
+#define ithare_obf_checksum_h_included
+
+//Checksums (CRC32C and XXH32) over obfuscated arrays, bit-for-bit equal to checksums of the plain data
+//  obf_crc32c_bytes()/obf_xxh32_bytes() - plain bytes; 
+//  obf_crc32c()/obf_xxh32() - arrays of OBFI?(T): elements are decoded lane-wise right into 64-bit words in registers 
+//    (as little-endian, i.e. the same bytes plain array has in memory on all our platforms), 
+//    which are fed directly into checksum rounds; only the <16-byte tail goes through a (wiped) stack buffer
+//  For arrays of plain types (identity encoding) obf_crc32c()/obf_xxh32() go straight to the byte versions
+//  NB: checksumming encoded form directly is NOT possible in general: kscope injections are not linear over GF(2)
+//  CRC32C uses SSE4.2 crc32 instruction if compiled with it (-msse4.2), slicing-by-8 otherwise
+//  Both are chainable: obf_crc32c_bytes(b,n2,obf_crc32c_bytes(a,n1)) == CRC32C of concatenation; 
+//    XXH32 is not chainable (same as original XXH32 without streaming state) 
+
+#include <string.h>
+#include <type_traits>
+#include "obf.h"
+#include "impl/obf_lib_kernels.h"
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define ITHARE_OBF_CHECKSUM_SSE42
+#endif
+
+namespace ithare {
+	namespace obf {
+		inline void obf_checksum_wipe(void* p, size_t n) {
+			volatile uint8_t* vp = static_cast<volatile uint8_t*>(p);
+			for (size_t i = 0; i < n; ++i)
+				vp[i] = 0;
+		}
+
+		//ObfLe64<T>: how plain values of OBFI?(T) are packed into little-endian 64-bit words
+		template<class ObfT>
+		struct ObfLe64 {
+			using Plain = typename ObfSizeofReport<ObfT>::plain_type;
+			using UPlain = typename std::make_unsigned<Plain>::type;
+			static_assert(std::is_integral<Plain>::value && sizeof(Plain) <= 8 && (sizeof(Plain) & (sizeof(Plain) - 1)) == 0);
+			static constexpr size_t per_word = 8 / sizeof(Plain);
+
+			static ITHARE_KSCOPE_FORCEINLINE uint64_t load(const ObfT* a) {//decodes per_word elements
+				uint64_t ret = 0;
+				for (size_t j = 0; j < per_word; ++j)
+					ret |= uint64_t(UPlain(obf_plain(a[j]))) << (8 * sizeof(Plain) * j);
+				return ret;
+			}
+			static void store_bytes(const ObfT* a, size_t n, uint8_t* out) {//decodes n elements into out[n*sizeof(Plain)]
+				for (size_t i = 0; i < n; ++i) {
+					UPlain v = UPlain(obf_plain(a[i]));
+					for (size_t b = 0; b < sizeof(Plain); ++b)
+						out[i * sizeof(Plain) + b] = uint8_t(v >> (8 * b));
+				}
+			}
+		};
+
+		inline uint64_t obf_checksum_read64(const uint8_t* p) {//little-endian
+			uint64_t ret;
+			memcpy(&ret, p, 8);
+			return ret;
+		}
+		inline uint32_t obf_checksum_read32(const uint8_t* p) {//little-endian
+			uint32_t ret;
+			memcpy(&ret, p, 4);
+			return ret;
+		}
+
+		/* ******************** CRC32C ******************** */
+		//moving globals into header (along the lines of https://stackoverflow.com/a/27070265)
+		template<class Dummy>
+		struct ObfCrc32cStaticData {
+			static const uint32_t (&table())[8][256] {
+				static const auto tbl = []() {
+					struct { uint32_t t[8][256]; } ret = {};
+					for (uint32_t i = 0; i < 256; ++i) {
+						uint32_t c = i;
+						for (int k = 0; k < 8; ++k)
+							c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+						ret.t[0][i] = c;
+					}
+					for (uint32_t i = 0; i < 256; ++i)
+						for (int s = 1; s < 8; ++s)
+							ret.t[s][i] = (ret.t[s-1][i] >> 8) ^ ret.t[0][ret.t[s-1][i] & 0xFF];
+					return ret;
+				}();
+				return tbl.t;
+			}
+		};
+
+		ITHARE_OBF_FORCEINLINE uint32_t obf_crc32c_u8(uint32_t crc, uint8_t b) {//on inverted crc
+#ifdef ITHARE_OBF_CHECKSUM_SSE42
+			return _mm_crc32_u8(crc, b);
+#else
+			return (crc >> 8) ^ ObfCrc32cStaticData<void>::table()[0][(crc ^ b) & 0xFF];
+#endif
+		}
+		ITHARE_OBF_FORCEINLINE uint32_t obf_crc32c_u64(uint32_t crc, uint64_t w) {//on inverted crc; w is little-endian 8 bytes
+#ifdef ITHARE_OBF_CHECKSUM_SSE42
+#if defined(__x86_64__) || defined(_M_X64)
+			return uint32_t(_mm_crc32_u64(crc, w));
+#else //_mm_crc32_u64() exists only in 64-bit mode
+			return _mm_crc32_u32(_mm_crc32_u32(crc, uint32_t(w)), uint32_t(w >> 32));
+#endif
+#else
+			const auto& t = ObfCrc32cStaticData<void>::table();
+			w ^= crc;
+			return t[7][w & 0xFF] ^ t[6][(w >> 8) & 0xFF] ^ t[5][(w >> 16) & 0xFF] ^ t[4][(w >> 24) & 0xFF] ^
+				t[3][(w >> 32) & 0xFF] ^ t[2][(w >> 40) & 0xFF] ^ t[1][(w >> 48) & 0xFF] ^ t[0][w >> 56];
+#endif
+		}
+
+		inline uint32_t obf_crc32c_bytes(const void* data, size_t n, uint32_t crc = 0) {
+			const uint8_t* p = static_cast<const uint8_t*>(data);
+			crc = ~crc;
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+				crc = obf_crc32c_u64(crc, obf_checksum_read64(p + i));
+			for (; i < n; ++i)
+				crc = obf_crc32c_u8(crc, p[i]);
+			return ~crc;
+		}
+
+		template<class ObfT>
+		uint32_t obf_crc32c(const ObfT* a, size_t n, uint32_t crc = 0) {
+			using Le = ObfLe64<ObfT>;
+			if constexpr(std::is_same<ObfT, typename Le::Plain>::value)
+				return obf_crc32c_bytes(a, n * sizeof(ObfT), crc);
+			else {
+				crc = ~crc;
+				size_t i = 0;
+				for (; i + Le::per_word <= n; i += Le::per_word)
+					crc = obf_crc32c_u64(crc, Le::load(a + i));
+				uint8_t tail[8];
+				size_t ntail = (n - i) * sizeof(typename Le::Plain);
+				Le::store_bytes(a + i, n - i, tail);
+				for (size_t j = 0; j < ntail; ++j)
+					crc = obf_crc32c_u8(crc, tail[j]);
+				obf_checksum_wipe(tail, sizeof(tail));
+				return ~crc;
+			}
+		}
+
+		/* ******************** XXH32 ******************** */
+		//the same as reference XXH32() (https://github.com/Cyan4973/xxHash) 
+		constexpr uint32_t obf_xxh32_p1 = 2654435761u;
+		constexpr uint32_t obf_xxh32_p2 = 2246822519u;
+		constexpr uint32_t obf_xxh32_p3 = 3266489917u;
+		constexpr uint32_t obf_xxh32_p4 = 668265263u;
+		constexpr uint32_t obf_xxh32_p5 = 374761393u;
+
+		ITHARE_OBF_FORCEINLINE uint32_t obf_xxh32_rotl(uint32_t x, int r) {
+			return (x << r) | (x >> (32 - r));
+		}
+		ITHARE_OBF_FORCEINLINE uint32_t obf_xxh32_round(uint32_t acc, uint32_t input) {
+			acc += input * obf_xxh32_p2;
+			acc = obf_xxh32_rotl(acc, 13);
+			return acc * obf_xxh32_p1;
+		}
+
+		struct ObfXxh32Lanes {
+			uint32_t v1, v2, v3, v4;
+			explicit ObfXxh32Lanes(uint32_t seed)
+			: v1(seed + obf_xxh32_p1 + obf_xxh32_p2), v2(seed + obf_xxh32_p2), v3(seed), v4(seed - obf_xxh32_p1) {
+			}
+			ITHARE_OBF_FORCEINLINE void stripe(uint64_t w0, uint64_t w1) {//16 bytes as two little-endian words
+				v1 = obf_xxh32_round(v1, uint32_t(w0));
+				v2 = obf_xxh32_round(v2, uint32_t(w0 >> 32));
+				v3 = obf_xxh32_round(v3, uint32_t(w1));
+				v4 = obf_xxh32_round(v4, uint32_t(w1 >> 32));
+			}
+			uint32_t merge() const {
+				return obf_xxh32_rotl(v1, 1) + obf_xxh32_rotl(v2, 7) + obf_xxh32_rotl(v3, 12) + obf_xxh32_rotl(v4, 18);
+			}
+		};
+
+		inline uint32_t obf_xxh32_finish(uint32_t h, const uint8_t* p, size_t n) {//n < 16
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				h += obf_checksum_read32(p + i) * obf_xxh32_p3;
+				h = obf_xxh32_rotl(h, 17) * obf_xxh32_p4;
+			}
+			for (; i < n; ++i) {
+				h += p[i] * obf_xxh32_p5;
+				h = obf_xxh32_rotl(h, 11) * obf_xxh32_p1;
+			}
+			h ^= h >> 15;
+			h *= obf_xxh32_p2;
+			h ^= h >> 13;
+			h *= obf_xxh32_p3;
+			h ^= h >> 16;
+			return h;
+		}
+
+		inline uint32_t obf_xxh32_bytes(const void* data, size_t n, uint32_t seed = 0) {
+			const uint8_t* p = static_cast<const uint8_t*>(data);
+			size_t i = 0;
+			uint32_t h;
+			if (n >= 16) {
+				ObfXxh32Lanes lanes(seed);
+				for (; i + 16 <= n; i += 16)
+					lanes.stripe(obf_checksum_read64(p + i), obf_checksum_read64(p + i + 8));
+				h = lanes.merge();
+			}
+			else
+				h = seed + obf_xxh32_p5;
+			h += uint32_t(n);
+			return obf_xxh32_finish(h, p + i, n - i);
+		}
+
+		template<class ObfT>
+		uint32_t obf_xxh32(const ObfT* a, size_t n, uint32_t seed = 0) {
+			using Le = ObfLe64<ObfT>;
+			if constexpr(std::is_same<ObfT, typename Le::Plain>::value)
+				return obf_xxh32_bytes(a, n * sizeof(ObfT), seed);
+			else {
+				constexpr size_t per_stripe = 2 * Le::per_word;
+				size_t nbytes = n * sizeof(typename Le::Plain);
+				size_t i = 0;
+				uint32_t h;
+				if (nbytes >= 16) {
+					ObfXxh32Lanes lanes(seed);
+					for (; i + per_stripe <= n; i += per_stripe)
+						lanes.stripe(Le::load(a + i), Le::load(a + i + Le::per_word));
+					h = lanes.merge();
+				}
+				else
+					h = seed + obf_xxh32_p5;
+				h += uint32_t(nbytes);
+				uint8_t tail[16];
+				Le::store_bytes(a + i, n - i, tail);
+				h = obf_xxh32_finish(h, tail, (n - i) * sizeof(typename Le::Plain));
+				obf_checksum_wipe(tail, sizeof(tail));
+				return h;
+			}
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_checksum_h_included
@@ -0,0 +1,308 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_config_h_included
+#define ithare_obf_config_h_included
+
+//Loading obfuscated fields from JSON configs without plaintext intermediates
+//  Single-pass parser over a (possibly mmap-ed) buffer, no DOM, no std::string-s and no heap allocations:
+//    numbers are accumulated digit-by-digit in a register and are injected directly into target OBFI?() fields, 
+//    found via field descriptors:
+//      struct Tuning { OBFI3(uint32_t) speed_cap; OBFI3(int32_t) cooldown; };
+//      static const ithare::obf::ObfConfigField<Tuning> tuning_fields[] = { 
+//        ITHARE_OBF_CONFIG_FIELD(Tuning,speed_cap), ITHARE_OBF_CONFIG_FIELD(Tuning,cooldown) };
+//      ithare::obf::obf_config_load(buf, size, tuning, tuning_fields);
+//  Nested objects map to dotted names ("limits.speed_cap") via ITHARE_OBF_CONFIG_FIELD_NAMED(); 
+//    top-level array of objects can be loaded with obf_config_load_array()
+//  Only integers are supported for fields; non-matching keys (of any JSON type) are skipped  
+//  If buffer is passed as non-const char*, digits of each parsed number are wiped in place right after parsing
+//    (so the plaintext doesn't stay in the file buffer); our own scratch (key path) is wiped on return 
+
+#include <string.h>
+#include <limits>
+#include <vector>
+#include "obf.h"
+#include "obf_checksum.h"//obf_checksum_wipe()
+
+namespace ithare {
+	namespace obf {
+		template<class Obj>
+		struct ObfConfigField {
+			const char* name;
+			size_t name_len;
+			bool (*set)(Obj& obj, uint64_t absval, bool neg);//returns false if out of range 
+		};
+
+		template<class Obj, class ObfT, ObfT Obj::*member>
+		bool obf_config_set_field(Obj& obj, uint64_t absval, bool neg) {
+			using T = typename ObfSizeofReport<ObfT>::plain_type;
+			static_assert(std::is_integral<T>::value);
+			if constexpr(std::is_signed<T>::value) {
+				using UT = typename std::make_unsigned<T>::type;
+				uint64_t limit = neg ? uint64_t(UT(std::numeric_limits<T>::max())) + 1 : uint64_t(std::numeric_limits<T>::max());
+				if (absval > limit)
+					return false;
+				obj.*member = neg ? T(UT(0) - UT(absval)) : T(absval);//no plain value stored in between
+			}
+			else {
+				if (neg || absval > uint64_t(std::numeric_limits<T>::max()))
+					return false;
+				obj.*member = T(absval);
+			}
+			return true;
+		}
+
+		template<class Obj, class ObfT, ObfT Obj::*member, size_t N>
+		constexpr ObfConfigField<Obj> obf_config_field(const char (&name)[N]) {
+			return ObfConfigField<Obj>{ name, N - 1, obf_config_set_field<Obj, ObfT, member> };
+		}
+
+		template<class Obj>
+		class ObfConfigParser {
+			char* wp;//non-null if we're allowed to wipe; points to the same buffer as begin
+			const char* begin;
+			const char* p;
+			const char* end;
+			const ObfConfigField<Obj>* fields;
+			size_t nfields;
+			static constexpr size_t max_path = 256;
+			char path[max_path];
+			size_t path_len = 0;
+
+			public:
+			ObfConfigParser(const char* data, char* wdata, size_t size, const ObfConfigField<Obj>* fields_, size_t nfields_)
+			: wp(wdata), begin(data), p(data), end(data + size), fields(fields_), nfields(nfields_) {
+			}
+			~ObfConfigParser() {
+				obf_checksum_wipe(path, sizeof(path));
+			}
+			ObfConfigParser(const ObfConfigParser&) = delete;
+			ObfConfigParser& operator =(const ObfConfigParser&) = delete;
+
+			bool parse_object(Obj& obj) {
+				skip_ws();
+				if (!consume('{'))
+					return false;
+				skip_ws();
+				if (consume('}'))
+					return true;
+				for (;;) {
+					skip_ws();
+					const char* key;
+					size_t key_len;
+					if (!parse_string(key, key_len))
+						return false;
+					skip_ws();
+					if (!consume(':'))
+						return false;
+					size_t saved_len = path_len;
+					if (!push_path(key, key_len))
+						return false;
+					skip_ws();
+					if (p < end && *p == '{') {
+						if (!parse_object(obj))
+							return false;
+					}
+					else {
+						const ObfConfigField<Obj>* f = find_field();
+						if (f) {
+							if (!parse_number(obj, *f))
+								return false;
+						}
+						else if (!skip_value())
+							return false;
+					}
+					path_len = saved_len;
+					skip_ws();
+					if (consume(','))
+						continue;
+					return consume('}');
+				}
+			}
+			bool parse_array(std::vector<Obj>& out) {
+				skip_ws();
+				if (!consume('['))
+					return false;
+				skip_ws();
+				if (consume(']'))
+					return true;
+				for (;;) {
+					out.emplace_back();
+					path_len = 0;
+					if (!parse_object(out.back()))
+						return false;
+					skip_ws();
+					if (consume(','))
+						continue;
+					return consume(']');
+				}
+			}
+			bool at_end() {
+				skip_ws();
+				return p == end;
+			}
+
+			private:
+			ITHARE_OBF_FORCEINLINE void skip_ws() {
+				while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+					++p;
+			}
+			ITHARE_OBF_FORCEINLINE bool consume(char c) {
+				if (p < end && *p == c) {
+					++p;
+					return true;
+				}
+				return false;
+			}
+			bool parse_string(const char*& s, size_t& len) {//NB: escapes are skipped, but not unescaped; it's ok for keys
+				if (!consume('"'))
+					return false;
+				s = p;
+				while (p < end && *p != '"') {
+					if (*p == '\\')
+						++p;
+					++p;
+				}
+				if (p >= end)
+					return false;
+				len = size_t(p - s);
+				++p;
+				return true;
+			}
+			bool push_path(const char* key, size_t key_len) {
+				size_t need = path_len + (path_len ? 1 : 0) + key_len;
+				if (need > max_path)
+					return false;
+				if (path_len)
+					path[path_len++] = '.';
+				memcpy(path + path_len, key, key_len);
+				path_len += key_len;
+				return true;
+			}
+			const ObfConfigField<Obj>* find_field() const {
+				for (size_t i = 0; i < nfields; ++i) {
+					if (fields[i].name_len == path_len && memcmp(fields[i].name, path, path_len) == 0)
+						return &fields[i];
+				}
+				return nullptr;
+			}
+			bool parse_number(Obj& obj, const ObfConfigField<Obj>& f) {
+				const char* started = p;
+				bool neg = consume('-');
+				if (p >= end || *p < '0' || *p > '9')
+					return false;
+				uint64_t v = 0;
+				bool overflow = false;
+				while (p < end && *p >= '0' && *p <= '9') {//going till the end of the number even on overflow, to wipe all of it
+					uint64_t digit = uint64_t(*p - '0');
+					if (v > (UINT64_MAX - digit) / 10)
+						overflow = true;
+					else
+						v = v * 10 + digit;
+					++p;
+				}
+				bool ok = !overflow && !(p < end && (*p == '.' || *p == 'e' || *p == 'E'));//only integers are supported
+				ok = ok && f.set(obj, v, neg);
+				wipe(started);
+				v = 0;
+				return ok;
+			}
+			void wipe(const char* from) {
+				if (!wp)
+					return;
+				char* w = wp + (from - begin);
+				for (const char* q = from; q < p; ++q, ++w)
+					*w = ' ';//keeping buffer a valid JSON-ish text
+			}
+			bool skip_value() {
+				skip_ws();
+				if (p >= end)
+					return false;
+				if (*p == '"') {
+					const char* s;
+					size_t len;
+					return parse_string(s, len);
+				}
+				if (*p == '{' || *p == '[') {//skipping nested containers without parsing them
+					int depth = 0;
+					while (p < end) {
+						char c = *p;
+						if (c == '"') {
+							const char* s;
+							size_t len;
+							if (!parse_string(s, len))
+								return false;
+							continue;
+						}
+						++p;
+						if (c == '{' || c == '[')
+							++depth;
+						else if (c == '}' || c == ']') {
+							if (--depth == 0)
+								return true;
+						}
+					}
+					return false;
+				}
+				while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+					++p;//number, true, false, null
+				return true;
+			}
+		};
+
+		template<class Obj, size_t N>
+		bool obf_config_load(const char* data, size_t size, Obj& obj, const ObfConfigField<Obj> (&fields)[N]) {
+			ObfConfigParser<Obj> parser(data, nullptr, size, fields, N);
+			return parser.parse_object(obj) && parser.at_end();
+		}
+		template<class Obj, size_t N>
+		bool obf_config_load(char* data, size_t size, Obj& obj, const ObfConfigField<Obj> (&fields)[N]) {//wiping numbers
+			ObfConfigParser<Obj> parser(data, data, size, fields, N);
+			return parser.parse_object(obj) && parser.at_end();
+		}
+		template<class Obj, size_t N>
+		bool obf_config_load_array(const char* data, size_t size, std::vector<Obj>& out, const ObfConfigField<Obj> (&fields)[N]) {
+			ObfConfigParser<Obj> parser(data, nullptr, size, fields, N);
+			return parser.parse_array(out) && parser.at_end();
+		}
+		template<class Obj, size_t N>
+		bool obf_config_load_array(char* data, size_t size, std::vector<Obj>& out, const ObfConfigField<Obj> (&fields)[N]) {//wiping numbers
+			ObfConfigParser<Obj> parser(data, data, size, fields, N);
+			return parser.parse_array(out) && parser.at_end();
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#define ITHARE_OBF_CONFIG_FIELD_NAMED(Obj,field,name) ithare::obf::obf_config_field<Obj, decltype(Obj::field), &Obj::field>(name)
+#define ITHARE_OBF_CONFIG_FIELD(Obj,field) ITHARE_OBF_CONFIG_FIELD_NAMED(Obj,field,#field)
+
+#endif //ithare_obf_config_h_included
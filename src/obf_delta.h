@@ -0,0 +1,146 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_delta_h_included
+#define ithare_obf_delta_h_included
+
+//Delta compression over snapshots of encoded state
+//  As long as both snapshots come from the same build (same ITHARE_OBF_SEED), the same value of the same OBFI?() field has the same encoded bytes, 
+//    so deltas can be computed and applied directly over encoded bytes, without decoding anything
+//  Delta format: sequence of (varint nskip, varint ndiff, ndiff 32-bit little-endian words XOR-ed with previous snapshot);
+//    nskip counts unchanged 32-bit words; trailing size%4 bytes (if any) are handled as a zero-padded word
+
+#include <string.h>
+#include <vector>
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+		inline void obf_delta_put_varint(std::vector<uint8_t>& out, size_t x) {
+			while (x >= 0x80) {
+				out.push_back(uint8_t(x | 0x80));
+				x >>= 7;
+			}
+			out.push_back(uint8_t(x));
+		}
+		inline bool obf_delta_get_varint(const uint8_t*& p, const uint8_t* end, size_t& x) {
+			x = 0;
+			for (int shift = 0; p < end && shift < 64; shift += 7) {
+				uint8_t b = *p++;
+				x |= size_t(b & 0x7f) << shift;
+				if (!(b & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		ITHARE_OBF_FORCEINLINE uint32_t obf_delta_word(const uint8_t* p, size_t i, size_t size) {
+			uint32_t w = 0;
+			size_t off = i * 4;
+			memcpy(&w, p + off, size - off < 4 ? size - off : 4);
+			return w;
+		}
+
+		//appends delta between prev and cur (both 'size' bytes) to out; returns size of the delta
+		inline size_t obf_delta_encode(const uint8_t* prev, const uint8_t* cur, size_t size, std::vector<uint8_t>& out) {
+			size_t start = out.size();
+			size_t nwords = (size + 3) / 4;
+			size_t i = 0;
+			while (i < nwords) {
+				size_t skip_from = i;
+				//fast-forward over unchanged 32-byte blocks first; memcmp() is vectorized by any decent libc 
+				while ((i + 8) * 4 <= size && memcmp(prev + i * 4, cur + i * 4, 32) == 0)
+					i += 8;
+				while (i < nwords && obf_delta_word(prev, i, size) == obf_delta_word(cur, i, size))
+					++i;
+				if (i == nwords && i > skip_from) {
+					obf_delta_put_varint(out, i - skip_from);
+					obf_delta_put_varint(out, 0);
+					break;
+				}
+				size_t diff_from = i;
+				while (i < nwords && obf_delta_word(prev, i, size) != obf_delta_word(cur, i, size))
+					++i;
+				obf_delta_put_varint(out, diff_from - skip_from);
+				obf_delta_put_varint(out, i - diff_from);
+				for (size_t j = diff_from; j < i; ++j) {
+					uint32_t x = obf_delta_word(prev, j, size) ^ obf_delta_word(cur, j, size);
+					for (int k = 0; k < 4; ++k)
+						out.push_back(uint8_t(x >> (k * 8)));
+				}
+			}
+			return out.size() - start;
+		}
+
+		//applies delta to snapshot in place; returns false if delta is malformed or doesn't fit snapshot 
+		//  (delta is validated before anything is applied, so on false snapshot is left untouched)
+		inline bool obf_delta_apply(uint8_t* snapshot, size_t size, const uint8_t* delta, size_t delta_size) {
+			const uint8_t* end = delta + delta_size;
+			size_t nwords = (size + 3) / 4;
+			for (int validate = 1; validate >= 0; --validate) {
+				const uint8_t* p = delta;
+				size_t i = 0;
+				while (p < end) {
+					size_t nskip, ndiff;
+					if (!obf_delta_get_varint(p, end, nskip) || !obf_delta_get_varint(p, end, ndiff))
+						return false;
+					if (nskip > nwords - i || ndiff > nwords - i - nskip || size_t(end - p) < ndiff * 4)
+						return false;
+					i += nskip;
+					if (validate) {
+						i += ndiff;
+						p += ndiff * 4;
+						continue;
+					}
+					for (size_t j = 0; j < ndiff; ++j, ++i, p += 4) {
+						uint32_t x = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+						uint32_t w = obf_delta_word(snapshot, i, size) ^ x;
+						size_t off = i * 4;
+						memcpy(snapshot + off, &w, size - off < 4 ? size - off : 4);
+					}
+				}
+			}
+			return true;
+		}
+
+		//convenience: snapshot of an array of trivially copyable (possibly OBFI?()-bearing) objects
+		template<class T>
+		std::vector<uint8_t> obf_snapshot(const T* objs, size_t n) {
+			static_assert(std::is_trivially_copyable<T>::value);
+			std::vector<uint8_t> ret(sizeof(T) * n);
+			memcpy(ret.data(), objs, ret.size());
+			return ret;
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_delta_h_included
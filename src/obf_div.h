@@ -0,0 +1,189 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef ithare_obf_div_h_included
+#define ithare_obf_div_h_included
+
+//ObfDivisor<OBFI?(T)>: division/modulo by rarely changing divisor, via precomputed reciprocal ("magic number")
+//  x/d for OBFI?(T) costs two surjections plus hardware divide (20-90 cycles for 64-bit); with ObfDivisor<>, 
+//    divisor and its magic number are stored encoded, decode() turns them into ObfDivisorPlain<> once per loop, 
+//    and each division becomes multiply-high + add + shifts (Granlund-Montgomery, "Division by Invariant Integers using Multiplication", 1994; 
+//    the same sequence compilers emit for constant divisors)
+//  Dividends still have to be surjected (none of our injections commutes with division), but it is a single surjection, 
+//    and it is branch-free
+//  Unsigned T only
+
+#include <assert.h>
+#include <stdint.h>
+#include <type_traits>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+#if !defined(__SIZEOF_INT128__) && defined(_MSC_VER) && defined(_M_X64)
+#define ITHARE_OBF_MULHI_UMULH
+#define ITHARE_OBF_MULHI_CONSTEXPR //__umulh() is not constexpr
+#else
+#define ITHARE_OBF_MULHI_CONSTEXPR constexpr
+#endif
+		//obf_mulhi(): upper half of a*b
+		template<class T>
+		ITHARE_OBF_FORCEINLINE ITHARE_OBF_MULHI_CONSTEXPR T obf_mulhi(T a, T b) {
+			static_assert(std::is_unsigned<T>::value);
+			constexpr size_t nbits = sizeof(T) * 8;
+			if constexpr(sizeof(T) < 8)
+				return T((uint64_t(a) * uint64_t(b)) >> nbits);
+			else {
+#if defined(__SIZEOF_INT128__)
+				return T((unsigned __int128)(a) * b >> 64);
+#elif defined(ITHARE_OBF_MULHI_UMULH)
+				return __umulh(a, b);
+#else
+				uint64_t alo = uint32_t(a), ahi = a >> 32, blo = uint32_t(b), bhi = b >> 32;
+				uint64_t lolo = alo * blo, hilo = ahi * blo, lohi = alo * bhi, hihi = ahi * bhi;
+				uint64_t mid = (lolo >> 32) + uint32_t(hilo) + uint32_t(lohi);
+				return hihi + (hilo >> 32) + (lohi >> 32) + (mid >> 32);
+#endif
+			}
+		}
+
+		template<class T>
+		struct ObfDivisorPlain {
+			static_assert(std::is_unsigned<T>::value);
+			static constexpr size_t nbits = sizeof(T) * 8;
+			T d = 1;
+			T m = 1;
+			uint8_t sh1 = 0;
+			uint8_t sh2 = 0;
+
+			constexpr ObfDivisorPlain() {
+			}
+			constexpr explicit ObfDivisorPlain(T d_) : d(d_) {
+				assert(d_ != 0);
+				size_t l = 0;//l = ceil(log2(d))
+				while (l < nbits && (T(1) << l) < d)
+					++l;
+				//m = floor(2^N * (2^l - d) / d) + 1; 2^l - d < d, so the quotient fits into T 
+				//  long division, with carry standing for bit N of the remainder
+				T a = T(T(l < nbits ? T(1) << l : 0) - d);
+				T r = a;
+				T q = 0;
+				for (size_t i = 0; i < nbits; ++i) {
+					bool carry = (r >> (nbits - 1)) != 0;
+					r = T(r << 1);
+					q = T(q << 1);
+					if (carry || r >= d) {
+						r = T(r - d);
+						q |= 1;
+					}
+				}
+				m = T(q + 1);
+				sh1 = uint8_t(l < 1 ? l : 1);
+				sh2 = uint8_t(l < 1 ? 0 : l - 1);
+			}
+
+			ITHARE_OBF_FORCEINLINE ITHARE_OBF_MULHI_CONSTEXPR T div(T x) const {
+				T t1 = obf_mulhi(m, x);
+				return T(T(t1 + T(T(x - t1) >> sh1)) >> sh2);
+			}
+			ITHARE_OBF_FORCEINLINE ITHARE_OBF_MULHI_CONSTEXPR T mod(T x) const {
+				return T(x - T(div(x) * d));
+			}
+		};
+
+		template<class ObfT>
+		class ObfDivisor {
+			public:
+			using T = typename ObfSizeofReport<ObfT>::plain_type;
+			static_assert(std::is_unsigned<T>::value, "ObfDivisor<> requires OBFI?(unsigned)");
+
+			private:
+			ObfT d;
+			ObfT m;
+			ObfT sh;//sh1 + 2*sh2 (sh1 is 0 or 1)
+
+			public:
+			explicit ObfDivisor(T d_ = 1) {
+				set(d_);
+			}
+			void set(T d_) {//expensive (~nbits iterations); intended for divisors which change rarely
+				ObfDivisorPlain<T> p(d_);
+				d = p.d;
+				m = p.m;
+				sh = T(p.sh1 + 2 * p.sh2);
+			}
+			T divisor() const {
+				return T(d);
+			}
+
+			//decode(): plain form, intended to be kept in registers for the duration of the loop
+			ITHARE_OBF_FORCEINLINE ObfDivisorPlain<T> decode() const {
+				ObfDivisorPlain<T> ret;
+				ret.d = T(d);
+				ret.m = T(m);
+				T s = T(sh);
+				ret.sh1 = uint8_t(s & 1);
+				ret.sh2 = uint8_t(s >> 1);
+				return ret;
+			}
+
+			//div()/mod(): one-off operations; X can be either T or OBFI?(T) 
+			template<class X>
+			ITHARE_OBF_FORCEINLINE T div(const X& x) const {
+				return decode().div(T(x));
+			}
+			template<class X>
+			ITHARE_OBF_FORCEINLINE T mod(const X& x) const {
+				return decode().mod(T(x));
+			}
+		};
+
+		//obf_divmod_n(): q[i] = x[i]/d, r[i] = x[i]%d; X, Q, and R can be either T or OBFI?(T); q or r can be nullptr
+		template<class X, class ObfT, class Q, class R>
+		void obf_divmod_n(const X* x, size_t n, const ObfDivisor<ObfT>& d, Q* q, R* r) {
+			using T = typename ObfDivisor<ObfT>::T;
+			ObfDivisorPlain<T> p = d.decode();
+			for (size_t i = 0; i < n; ++i) {
+				T xx = T(x[i]);
+				T qq = p.div(xx);
+				if (q)
+					q[i] = qq;
+				if (r)
+					r[i] = T(xx - T(qq * p.d));
+			}
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_div_h_included
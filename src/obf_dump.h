@@ -0,0 +1,223 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_dump_h_included
+#define ithare_obf_dump_h_included
+
+//Offline decoder for memory dumps/core files of obfuscated builds
+//  Obfuscation of OBFI?() is determined by ITHARE_OBF_SEED AND by the point of declaration, 
+//    so (same as for ITHARE_OBF_LOG_DECODER) the decoder is built from THE SAME sources with THE SAME ITHARE_OBF_SEED,
+//    and decodes words using exactly the same surjections as the runtime does
+//  Usage: 
+//    1. keep obfuscated types you want to see in dumps as typedefs in shared headers: using Gold = OBFI3(uint32_t);
+//    2. in the decoder: ITHARE_OBF_DUMP_TYPE(gold,Gold); ... int main(int argc, char** argv) { return ithare::obf::obf_dump_main(argc,argv); }
+//    3. decoder types
+//       decoder decode <dumpfile> <type> <offset> <count>  - prints count decoded values starting from offset
+//       decoder find <dumpfile> <type> <value> [align]     - prints offsets of all the words which decode into value
+//  NB: there is nothing to decode for OBFS?L() literals - decoder build has them in source form anyway 
+//  NB: on 32-bit *nix, the decoder MUST be built with -D_FILE_OFFSET_BITS=64 (otherwise off_t is 32-bit, and it won't compile)
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+		struct ObfDumpTypeDescr {
+			const char* name;
+			size_t size;
+			bool is_signed;
+			void (*decode)(const uint8_t* in, size_t n, uint64_t* out);//n values from packed array
+			void (*encode)(uint64_t x, uint8_t* out);
+		};
+
+		template<class Dummy>
+		struct ObfDumpRegistry {
+			static std::vector<ObfDumpTypeDescr>& types() {
+				static std::vector<ObfDumpTypeDescr> ret;//function-static to avoid static-init-order issues
+				return ret;
+			}
+			static const ObfDumpTypeDescr* find(const char* name) {
+				for (const ObfDumpTypeDescr& t : types()) {
+					if (strcmp(t.name, name) == 0)
+						return &t;
+				}
+				return nullptr;
+			}
+		};
+
+		template<class ObfT>
+		struct ObfDumpType {
+			static_assert(std::is_trivially_copyable<ObfT>::value);
+			using plain_type = typename ObfSizeofReport<ObfT>::plain_type;
+			static_assert(std::is_integral<plain_type>::value);
+
+			static void decode(const uint8_t* in, size_t n, uint64_t* out) {
+				for (size_t i = 0; i < n; ++i) {
+					ObfT x;
+					memcpy(&x, in + i * sizeof(ObfT), sizeof(ObfT));
+					out[i] = uint64_t(plain_type(x));
+				}
+			}
+			static void encode(uint64_t v, uint8_t* out) {
+				ObfT x = plain_type(v);
+				memcpy(out, &x, sizeof(ObfT));
+			}
+			static bool do_register(const char* name) {
+				ObfDumpRegistry<void>::types().push_back(ObfDumpTypeDescr{ name, sizeof(ObfT), std::is_signed<plain_type>::value, decode, encode });
+				return true;
+			}
+		};
+
+		inline int obf_dump_seek(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+			return _fseeki64(f, int64_t(offset), SEEK_SET);
+#else
+			static_assert(sizeof(off_t) >= sizeof(int64_t), "32-bit off_t: build the decoder with -D_FILE_OFFSET_BITS=64");
+			return fseeko(f, off_t(offset), SEEK_SET);
+#endif
+		}
+
+		inline void obf_dump_print_value(const ObfDumpTypeDescr& t, uint64_t v) {
+			if (t.is_signed) {
+				int64_t sv = int64_t(v << (64 - t.size * 8)) >> (64 - t.size * 8);//sign-extending
+				std::cout << sv;
+			}
+			else
+				std::cout << v;
+		}
+
+		constexpr size_t obf_dump_chunk = 1 << 20;//values per chunk
+
+		inline int obf_dump_decode(FILE* f, const ObfDumpTypeDescr& t, uint64_t offset, uint64_t count) {
+			if (obf_dump_seek(f, offset) != 0)
+				return 1;
+			std::unique_ptr<uint8_t[]> in(new uint8_t[obf_dump_chunk * t.size]);
+			std::unique_ptr<uint64_t[]> out(new uint64_t[obf_dump_chunk]);
+			while (count) {
+				size_t n = count < obf_dump_chunk ? size_t(count) : obf_dump_chunk;
+				size_t got = fread(in.get(), t.size, n, f);
+				t.decode(in.get(), got, out.get());
+				for (size_t i = 0; i < got; ++i) {
+					std::cout << "0x" << std::hex << (offset + i * t.size) << std::dec << " ";
+					obf_dump_print_value(t, out[i]);
+					std::cout << '\n';
+				}
+				if (got < n)
+					break;
+				offset += got * t.size;
+				count -= got;
+			}
+			std::cout.flush();
+			return 0;
+		}
+
+		inline int obf_dump_find(FILE* f, const ObfDumpTypeDescr& t, uint64_t value, size_t align) {
+			assert(align != 0);
+			std::unique_ptr<uint8_t[]> needle(new uint8_t[t.size]);//non-compact OBFI?() types can be wider than uint64_t
+			t.encode(value, needle.get());
+			//scanning encoded form; chunks overlap by t.size-1 bytes so that words crossing chunk boundary are not missed
+			const size_t bufsz = obf_dump_chunk * 16;
+			std::unique_ptr<uint8_t[]> buf(new uint8_t[bufsz]);
+			uint64_t base = 0;
+			size_t have = 0;
+			for (;;) {
+				size_t got = fread(buf.get() + have, 1, bufsz - have, f);
+				have += got;
+				if (have < t.size)
+					break;
+				size_t last = have - t.size;
+				for (size_t i = size_t((align - base % align) % align); i <= last; i += align) {
+					if (memcmp(buf.get() + i, needle.get(), t.size) == 0)
+						std::cout << "0x" << std::hex << (base + i) << std::dec << '\n';
+				}
+				if (got == 0)
+					break;
+				size_t keep = t.size - 1;
+				memmove(buf.get(), buf.get() + have - keep, keep);
+				base += have - keep;
+				have = keep;
+			}
+			std::cout.flush();
+			return 0;
+		}
+
+		inline int obf_dump_main(int argc, char** argv) {
+			if (argc >= 2 && strcmp(argv[1], "types") == 0) {
+				for (const ObfDumpTypeDescr& t : ObfDumpRegistry<void>::types())
+					std::cout << t.name << " sizeof=" << t.size << (t.is_signed ? " signed" : "") << std::endl;
+				return 0;
+			}
+			bool is_decode = argc == 6 && strcmp(argv[1], "decode") == 0;
+			bool is_find = (argc == 5 || argc == 6) && strcmp(argv[1], "find") == 0;
+			if (!is_decode && !is_find) {
+				std::cerr << "Usage: " << argv[0] << " types | decode <dumpfile> <type> <offset> <count> | find <dumpfile> <type> <value> [align]" << std::endl;
+				return 2;
+			}
+			const ObfDumpTypeDescr* t = ObfDumpRegistry<void>::find(argv[3]);
+			if (!t) {
+				std::cerr << "Unknown type " << argv[3] << std::endl;
+				return 2;
+			}
+			size_t align = t->size;
+			if (is_find && argc == 6) {
+				align = size_t(strtoull(argv[5], nullptr, 0));
+				if (align == 0) {
+					std::cerr << "align must be non-zero" << std::endl;
+					std::cerr << "Usage: " << argv[0] << " types | decode <dumpfile> <type> <offset> <count> | find <dumpfile> <type> <value> [align]" << std::endl;
+					return 2;
+				}
+			}
+			FILE* f = fopen(argv[2], "rb");
+			if (!f) {
+				std::cerr << "Cannot open " << argv[2] << std::endl;
+				return 2;
+			}
+			int ret;
+			if (is_decode)
+				ret = obf_dump_decode(f, *t, strtoull(argv[4], nullptr, 0), strtoull(argv[5], nullptr, 0));
+			else
+				ret = obf_dump_find(f, *t, strtoull(argv[4], nullptr, 0), align);
+			fclose(f);
+			return ret;
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#define ITHARE_OBF_DUMP_TYPE(name,...) static bool ithare_obf_dump_type_##name = ithare::obf::ObfDumpType<__VA_ARGS__>::do_register(#name)
+
+#endif //ithare_obf_dump_h_included
@@ -34,6 +34,26 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ithare_obf_lib_h_included
 
 #include "obf.h"
+#include "impl/obf_lib_kernels.h"
+
+//library functions are templates over obfflags (plus extra params): 
+//  ithare::obf::obf_fill<0>(arr, v) is a runtime call (encoded-domain fast paths from impl/obf_lib_kernels.h),
+//  ithare::obf::obf_fill<ithare::obf::obf_flag_is_constexpr>(arr, v) is usable within constant expressions
+//  NB: loop counters within library functions are NOT obfuscated (ITHARE_OBFLIBF(T) is plain T); 
+//      arrays passed in keep their OBFI?() encoding
+namespace ithare {
+	namespace obf {
+		using OBFLIBFLAGS = uint32_t;
+		constexpr OBFLIBFLAGS obf_flag_is_constexpr = 0x1;
+		constexpr bool obf_avoid_memxxx = false;
+	}//namespace obf
+}//namespace ithare
+
+#define ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(...) template<ithare::obf::OBFLIBFLAGS obfflags, __VA_ARGS__> constexpr
+#define ITHARE_OBFLIBF(T) T
+#define ITHARE_OBFILIBF(N) (N)
+#define ITHARE_OBF_DBGPRINTLIBFUNCNAME(fname)
+#define ITHARE_OBF_DBGPRINTLIB(x)
 
 namespace ithare {
 	namespace obf {
@@ -50,7 +70,7 @@ namespace ithare {
 			}
 			else {
 				assert(sizeof(T) == sizeof(T2));
-				memcpy(to, from, sizeof(T));
+				memcpy(to, from, sizeof(T)*N);
 			}
 		}
 		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, size_t N)
@@ -66,6 +86,129 @@ namespace ithare {
 			else
 				memset(to, 0, sizeof(T)*N);
 		}
+		//obf_equal()/obf_memcmp(): constant-time comparisons of obfuscated arrays (tokens, keys, hashes, ...)
+		//  in encoded domain if both sides share encoding, lane-wise otherwise; see impl/obf_lib_kernels.h
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, class T2, size_t N)
+		bool obf_equal(const T(&a)[N], const T2(&b)[N]) {
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_equal");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				uint64_t acc = 0;
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					acc |= uint64_t(obf_plain(a[i])) ^ uint64_t(obf_plain(b[i]));//no early exit, even in constexpr
+				}
+				return acc == 0;
+			}
+			else
+				return obf_ct_equal(a, b, N);
+		}
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, class T2, size_t N)
+		int obf_memcmp(const T(&a)[N], const T2(&b)[N]) {
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_memcmp");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				int ret = 0;
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					auto x = obf_plain(a[i]);
+					auto y = obf_plain(b[i]);
+					if (ret == 0)//NB: constexpr evaluation happens at compile-time, so timing is not an issue
+						ret = int(x > y) - int(x < y);
+				}
+				return ret;
+			}
+			else
+				return obf_ct_compare(a, b, N);
+		}
+		//obf_fill()/obf_find()/obf_count()/obf_accumulate()/obf_minmax()/obf_reverse()
+		//  fast paths work in encoded domain where possible; see impl/obf_lib_kernels.h
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, class T2, size_t N)
+		void obf_fill(T(&to)[N], const T2& value) {
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_fill");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					to[i] = value;
+				}
+			}
+			else
+				obf_fill_n(to, N, value);
+		}
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, class T2, size_t N)
+		size_t obf_find(const T(&a)[N], const T2& value) {//returns N if not found
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_find");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					if (obf_plain(a[i]) == obf_plain(value))
+						return i;
+				}
+				return N;
+			}
+			else
+				return obf_find_n(a, N, value);
+		}
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, class T2, size_t N)
+		size_t obf_count(const T(&a)[N], const T2& value) {
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_count");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				ITHARE_OBFLIBF(size_t) ret = 0;
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					if (obf_plain(a[i]) == obf_plain(value))
+						++ret;
+				}
+				return ret;
+			}
+			else
+				return obf_count_n(a, N, value);
+		}
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, class Acc, size_t N)
+		Acc obf_accumulate(const T(&a)[N], Acc init) {
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_accumulate");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					init += obf_plain(a[i]);
+				}
+				return init;
+			}
+			else
+				return obf_accumulate_n(a, N, init);
+		}
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, size_t N)
+		auto obf_minmax(const T(&a)[N]) {//returns std::pair<> of plain values
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_minmax");//no 'X'
+			static_assert(N > 0);
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				auto mn = obf_plain(a[0]);
+				auto mx = mn;
+				for (ITHARE_OBFLIBF(size_t) i = 1; i < n; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					auto x = obf_plain(a[i]);
+					if (x < mn)
+						mn = x;
+					if (x > mx)
+						mx = x;
+				}
+				return std::pair(mn, mx);
+			}
+			else
+				return obf_minmax_n(a, N);
+		}
+		ITHARE_OBF_DECLARELIBFUNC_WITHEXTRA(class T, size_t N)
+		void obf_reverse(T(&a)[N]) {
+			ITHARE_OBF_DBGPRINTLIBFUNCNAME("obf_reverse");//no 'X'
+			if constexpr((obfflags&obf_flag_is_constexpr) != 0) {
+				auto n = ITHARE_OBFILIBF(N); ITHARE_OBF_DBGPRINTLIB(n);
+				for (ITHARE_OBFLIBF(size_t) i = 0; i < n / 2; ++i) { ITHARE_OBF_DBGPRINTLIB(i);
+					T tmp = a[i];
+					a[i] = a[n - 1 - i];
+					a[n - 1 - i] = tmp;
+				}
+			}
+			else
+				obf_reverse_n(a, N);
+		}
 	}//namespace obf
 }//namespace ithare 
 
@@ -0,0 +1,244 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_log_h_included
+#define ithare_obf_log_h_included
+
+//Deferred-decode binary logging
+//  ITHARE_OBF_LOG("format with {} placeholders",obf_value1,obf_value2,...) does NOT decode anything: 
+//    it only copies encoded words (object representations) of its arguments, plus a 32-bit site id, into a per-thread buffer
+//    (which costs a few stores; there is no locking and no formatting)
+//  Format strings are NOT compiled into normal builds at all, so it is a natural place to put literals 
+//    (instead of logging OBFS?L() ones)
+//  To read the logs: build a decoder from THE SAME sources with THE SAME ITHARE_OBF_SEED, adding -DITHARE_OBF_LOG_DECODER,
+//    and call obf_log_decode() from it; with ITHARE_OBF_LOG_DECODER, each ITHARE_OBF_LOG() site registers 
+//    its format string and argument types at static-init time 
+//  NB: buffers are flushed (to the FILE* set via obf_log_set_sink()) when full, or on obf_log_flush(); 
+//      call obf_log_flush() from each logging thread before it exits, otherwise the tail of its log is lost
+//  NB: arguments MUST be trivially copyable; plain (non-obfuscated) arguments are logged as-is
+
+#include <stdio.h>
+#include <atomic>
+#include <iostream>
+#include "obf.h"
+#ifdef ITHARE_OBF_LOG_DECODER
+#include <unordered_map>
+#endif
+
+namespace ithare {
+	namespace obf {
+		constexpr uint32_t obf_log_site_id(const char* file, int line) {
+			//FNV-1a over file basename and line; basename - to avoid depending on the build directory
+			const char* base = file;
+			for (const char* p = file; *p; ++p) {
+				if (*p == '/' || *p == '\\')
+					base = p + 1;
+			}
+			uint32_t h = UINT32_C(2166136261);
+			for (const char* p = base; *p; ++p) {
+				h ^= uint8_t(*p);
+				h *= UINT32_C(16777619);
+			}
+			for (int i = 0; i < 4; ++i) {
+				h ^= uint8_t(line >> (i * 8));
+				h *= UINT32_C(16777619);
+			}
+			return h;
+		}
+
+		constexpr uint32_t obf_log_block_magic = UINT32_C(0x4c46'424f);//"OBFL"
+		//block: magic(4) thread_tag(4) nbytes(4) records(nbytes)
+		//record: site_id(4) payload_size(2) payload(payload_size)
+
+		//moving globals into header (along the lines of https://stackoverflow.com/a/27070265)
+		template<class Dummy>
+		struct ObfLogStaticData {
+			static constexpr size_t buffer_size = 65536;
+			static std::atomic<FILE*> sink;
+			static std::atomic<uint32_t> last_thread_tag;
+			
+			struct ThreadBuffer {//trivial on purpose: no TLS init guards on each access
+				uint32_t used;
+				uint32_t thread_tag;
+				uint8_t data[buffer_size];
+			};
+			static thread_local ThreadBuffer buf;
+		};
+		template<class Dummy>
+		std::atomic<FILE*> ObfLogStaticData<Dummy>::sink = nullptr;
+		template<class Dummy>
+		std::atomic<uint32_t> ObfLogStaticData<Dummy>::last_thread_tag = 0;
+		template<class Dummy>
+		thread_local typename ObfLogStaticData<Dummy>::ThreadBuffer ObfLogStaticData<Dummy>::buf;
+
+		inline void obf_log_set_sink(FILE* f) {
+			ObfLogStaticData<void>::sink.store(f);
+		}
+		
+		ITHARE_OBF_NOINLINE inline void obf_log_flush() {
+			auto& buf = ObfLogStaticData<void>::buf;
+			if (!buf.used)
+				return;
+			if (!buf.thread_tag)
+				buf.thread_tag = ++ObfLogStaticData<void>::last_thread_tag;
+			FILE* f = ObfLogStaticData<void>::sink.load();
+			if (f) {
+				uint32_t hdr[3] = { obf_log_block_magic, buf.thread_tag, buf.used };
+				//each fwrite() locks FILE only for itself, so the whole block goes under an explicit lock 
+				//  (otherwise another thread's block may land between our header and our data)
+#ifdef _MSC_VER
+				_lock_file(f);
+#else
+				flockfile(f);
+#endif
+				fwrite(hdr, sizeof(hdr), 1, f);
+				fwrite(buf.data, buf.used, 1, f);
+#ifdef _MSC_VER
+				_unlock_file(f);
+#else
+				funlockfile(f);
+#endif
+			}
+			buf.used = 0;
+		}
+
+#ifdef ITHARE_OBF_LOG_DECODER
+		struct ObfLogSiteDescr {
+			const char* fmt;
+			void (*print)(std::ostream& os, const char* fmt, const uint8_t* payload);
+		};
+		
+		template<class Dummy>
+		struct ObfLogDecoderRegistry {
+			static std::unordered_map<uint32_t,ObfLogSiteDescr>& sites() {
+				static std::unordered_map<uint32_t,ObfLogSiteDescr> ret;//function-static to avoid static-init-order issues
+				return ret;
+			}
+		};
+		
+		template<class Arg>
+		void obf_log_print_arg(std::ostream& os, const char*& fmt, const uint8_t*& payload) {
+			while (*fmt && !(fmt[0] == '{' && fmt[1] == '}'))
+				os << *fmt++;
+			if (*fmt)
+				fmt += 2;
+			Arg arg;
+			memcpy(&arg, payload, sizeof(Arg));
+			payload += sizeof(Arg);
+			os << +typename ObfSizeofReport<Arg>::plain_type(arg);//this is the only place where decoding happens
+		}
+
+		template<uint32_t site, class Fmt, class... Args>
+		struct ObfLogSite {
+			static void print(std::ostream& os, const char* fmt, const uint8_t* payload) {
+				(obf_log_print_arg<Args>(os, fmt, payload), ...);
+				(void)payload;//for sites without arguments
+				os << fmt;
+			}
+			static bool do_register() {
+				auto inserted = ObfLogDecoderRegistry<void>::sites().insert({site, ObfLogSiteDescr{Fmt::str(), print}});
+				assert(inserted.second || inserted.first->second.print == print);//site id collision
+				return inserted.second;
+			}
+			inline static bool registered = do_register();
+		};
+		
+		inline bool obf_log_decode(std::istream& in, std::ostream& out) {//returns false if there was an unknown site or malformed input
+			bool ok = true;
+			uint32_t hdr[3];
+			while (in.read(reinterpret_cast<char*>(hdr), sizeof(hdr))) {
+				if (hdr[0] != obf_log_block_magic)
+					return false;
+				std::string block(hdr[2], '\0');
+				if (!in.read(&block[0], hdr[2]))
+					return false;
+				const uint8_t* p = reinterpret_cast<const uint8_t*>(block.data());
+				const uint8_t* end = p + block.size();
+				while (p + 6 <= end) {
+					uint32_t site;
+					uint16_t sz;
+					memcpy(&site, p, 4);
+					memcpy(&sz, p + 4, 2);
+					p += 6;
+					if (p + sz > end)
+						return false;
+					out << "[" << hdr[1] << "] ";
+					auto found = ObfLogDecoderRegistry<void>::sites().find(site);
+					if (found == ObfLogDecoderRegistry<void>::sites().end()) {
+						out << "<unknown site " << std::hex << site << std::dec << ">" << std::endl;
+						ok = false;
+					}
+					else {
+						found->second.print(out, found->second.fmt, p);
+						out << std::endl;
+					}
+					p += sz;
+				}
+			}
+			return ok;
+		}
+#endif //ITHARE_OBF_LOG_DECODER
+
+		template<uint32_t site, class Fmt, class... Args>
+		ITHARE_OBF_FORCEINLINE void obf_log(Fmt, const Args&... args) {
+#ifdef ITHARE_OBF_LOG_DECODER
+			(void)ObfLogSite<site, Fmt, Args...>::registered;
+#endif
+			static_assert((std::is_trivially_copyable<Args>::value && ...));
+			constexpr size_t payload_size = (sizeof(Args) + ... + 0);
+			static_assert(payload_size <= UINT16_MAX);
+			constexpr size_t sz = 6 + payload_size;
+			static_assert(sz <= ObfLogStaticData<void>::buffer_size);//otherwise even an empty buffer cannot hold the record
+			auto& buf = ObfLogStaticData<void>::buf;
+			if (buf.used + sz > ObfLogStaticData<void>::buffer_size)
+				obf_log_flush();
+			uint8_t* p = buf.data + buf.used;
+			uint32_t site_id = site;
+			uint16_t psz = uint16_t(payload_size);
+			memcpy(p, &site_id, 4);
+			memcpy(p + 4, &psz, 2);
+			p += 6;
+			((memcpy(p, &args, sizeof(Args)), p += sizeof(Args)), ...);
+			buf.used += uint32_t(sz);
+		}
+	}//namespace obf
+}//namespace ithare 
+
+//NB: ##__VA_ARGS__ (supported by GCC, Clang, and MSVC) - to allow ITHARE_OBF_LOG() without arguments
+//format string lives only within ObfLogFmt::str(), which is never called (and therefore never emitted) unless ITHARE_OBF_LOG_DECODER is defined
+#define ITHARE_OBF_LOG(fmt,...) ithare::obf::obf_log<ithare::obf::obf_log_site_id(__FILE__,__LINE__)>([]{ struct ObfLogFmt { static const char* str() { return fmt; } }; return ObfLogFmt(); }(), ##__VA_ARGS__)
+
+#ifndef ITHARE_OBF_NO_SHORT_DEFINES
+#define OBFLOG ITHARE_OBF_LOG
+#endif
+
+#endif //ithare_obf_log_h_included
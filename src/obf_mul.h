@@ -0,0 +1,188 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef ithare_obf_mul_h_included
+#define ithare_obf_mul_h_included
+
+//ObfMulInt<T,seed>: integer stored as y = C*x mod 2^N, with odd C (and its inverse CINV) derived from seed
+//  this is the same encoding as "mul odd mod 2^N" injection of kscope, but without anything applied on top of it, 
+//    which makes it ring-linear: E(a)+E(b) == E(a+b), E(a)*b == E(a*b), E(a)*E(b)*CINV == E(a*b)
+//  as a result, +, -, *plain and ==/!= run directly over encoded values, and encoded*encoded costs one correction multiply 
+//    (instead of two surjections and one injection for OBFI?(T));
+//    dot products need one correction for the whole sum
+//  NB: being linear, it is much weaker than full-scale OBFI?(T) - use it for hot multiplicative state (factorials, hashes, 
+//    fixed-point products), and store the result into OBFI?(T) when the computation is done 
+//  NB: kscope's own KscopeInt dispatches operator*=() within kscope; obf_mul_caps<> below is what obf code can rely on 
+
+#include <assert.h>
+#include <type_traits>
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+		using OBFMULCAPS = uint32_t;
+		constexpr OBFMULCAPS obf_mul_caps_add = 0x1;//E(a)+E(b) == E(a+b)
+		constexpr OBFMULCAPS obf_mul_caps_mul_by_plain = 0x2;//E(a)*b == E(a*b)
+		constexpr OBFMULCAPS obf_mul_caps_mul = 0x4;//E(a)*E(b) == E(a*b) up to one correction multiply
+		constexpr OBFMULCAPS obf_mul_caps_equal = 0x8;//E(a)==E(b) iff a==b
+
+		template<class T, uint64_t seed>
+		class ObfMulInt {
+			static_assert(std::is_integral<T>::value);
+			using UT = typename std::make_unsigned<T>::type;
+			using WT = typename std::conditional<(sizeof(UT) < sizeof(unsigned)), unsigned, UT>::type;//avoiding promotion to (overflowing) int
+
+			public:
+			static constexpr UT mul(UT a, UT b) {//wrap-around
+				return UT(WT(a) * WT(b));
+			}
+			static constexpr UT C = seed == 0 ? UT(1) : UT(obf_splitmix64(seed) | 1);
+			static constexpr UT CINV = obf_mul_inverse(C);
+			static_assert(mul(C, CINV) == 1);
+			static constexpr OBFMULCAPS mul_caps = obf_mul_caps_add | obf_mul_caps_mul_by_plain | obf_mul_caps_mul | obf_mul_caps_equal;
+
+			private:
+			UT y;
+
+			struct Encoded {};
+			constexpr ObfMulInt(Encoded, UT y_) : y(y_) {
+			}
+
+			public:
+			constexpr ObfMulInt() : y(0) {
+			}
+			constexpr ObfMulInt(T x) : y(mul(UT(x), C)) {
+			}
+			constexpr T value() const {
+				return T(mul(y, CINV));
+			}
+			constexpr explicit operator T() const {
+				return value();
+			}
+
+			//encoded(): access to raw representation, for kernels such as obf_mul_dot_n() 
+			constexpr UT encoded() const {
+				return y;
+			}
+			static constexpr ObfMulInt from_encoded(UT y) {
+				return ObfMulInt(Encoded(), y);
+			}
+
+			ITHARE_OBF_FORCEINLINE ObfMulInt& operator+=(ObfMulInt b) {
+				y = UT(y + b.y);
+				return *this;
+			}
+			ITHARE_OBF_FORCEINLINE ObfMulInt& operator-=(ObfMulInt b) {
+				y = UT(y - b.y);
+				return *this;
+			}
+			ITHARE_OBF_FORCEINLINE ObfMulInt& operator*=(T b) {//no correction needed
+				y = mul(y, UT(b));
+				return *this;
+			}
+			ITHARE_OBF_FORCEINLINE ObfMulInt& operator*=(ObfMulInt b) {//C*a * C*b * CINV == C*(a*b)
+				y = mul(mul(y, b.y), CINV);
+				return *this;
+			}
+			ITHARE_OBF_FORCEINLINE ObfMulInt& operator++() {
+				y = UT(y + C);
+				return *this;
+			}
+			ITHARE_OBF_FORCEINLINE ObfMulInt& operator--() {
+				y = UT(y - C);
+				return *this;
+			}
+
+			friend ITHARE_OBF_FORCEINLINE ObfMulInt operator+(ObfMulInt a, ObfMulInt b) {
+				return a += b;
+			}
+			friend ITHARE_OBF_FORCEINLINE ObfMulInt operator-(ObfMulInt a, ObfMulInt b) {
+				return a -= b;
+			}
+			friend ITHARE_OBF_FORCEINLINE ObfMulInt operator*(ObfMulInt a, T b) {
+				return a *= b;
+			}
+			friend ITHARE_OBF_FORCEINLINE ObfMulInt operator*(ObfMulInt a, ObfMulInt b) {
+				return a *= b;
+			}
+			friend ITHARE_OBF_FORCEINLINE bool operator==(ObfMulInt a, ObfMulInt b) {
+				return a.y == b.y;
+			}
+			friend ITHARE_OBF_FORCEINLINE bool operator!=(ObfMulInt a, ObfMulInt b) {
+				return a.y != b.y;
+			}
+			//NB: no ordering comparisons - encoding doesn't preserve order, use value() 
+		};
+
+		//obf_mul_caps<T>: multiplicative caps of T; 0 for everything except ObfMulInt<> (in particular, for OBFI?(T))
+		template<class T>
+		constexpr OBFMULCAPS obf_mul_caps = 0;
+		template<class T, uint64_t seed>
+		constexpr OBFMULCAPS obf_mul_caps<ObfMulInt<T,seed>> = ObfMulInt<T,seed>::mul_caps;
+
+		//obf_mul_dot_n(): sum of a[i]*b[i] without decoding a single element
+		//  encoded*plain: every term is already E(a[i]*b[i]), no correction at all
+		template<class T, uint64_t seed>
+		ObfMulInt<T,seed> obf_mul_dot_n(const ObfMulInt<T,seed>* a, const T* b, size_t n) {
+			using UT = typename std::make_unsigned<T>::type;
+			UT acc = 0;
+			for (size_t i = 0; i < n; ++i)
+				acc = UT(acc + ObfMulInt<T,seed>::mul(a[i].encoded(), UT(b[i])));
+			return ObfMulInt<T,seed>::from_encoded(acc);
+		}
+		//  encoded*encoded: sum of C^2*a[i]*b[i], one correction multiply for the whole sum
+		template<class T, uint64_t seed>
+		ObfMulInt<T,seed> obf_mul_dot_n(const ObfMulInt<T,seed>* a, const ObfMulInt<T,seed>* b, size_t n) {
+			using UT = typename std::make_unsigned<T>::type;
+			UT acc = 0;
+			for (size_t i = 0; i < n; ++i)
+				acc = UT(acc + ObfMulInt<T,seed>::mul(a[i].encoded(), b[i].encoded()));
+			return ObfMulInt<T,seed>::from_encoded(ObfMulInt<T,seed>::mul(acc, ObfMulInt<T,seed>::CINV));
+		}
+
+#ifdef ITHARE_OBF_SEED
+		constexpr uint64_t obf_mul_seed(const char* tag) {
+			return obf_splitmix64(uint64_t(ITHARE_OBF_SEED) ^ obf_tag_hash(tag) ^ UINT64_C(0x6d75'6c69'6e74'0000)) | 1;//never 0 
+		}
+#else
+		constexpr uint64_t obf_mul_seed(const char*) {
+			return 0;
+		}
+#endif
+	}//namespace obf
+}//namespace ithare 
+
+//ITHARE_OBF_MUL_INT(T,tag): tag is any identifier which, together with ITHARE_OBF_SEED, determines C
+//  same rules as for ITHARE_OBF_STRUCT(): tag MUST be the same in all TUs using the type, and SHOULD be unique across the project;
+//  values with the same T and tag share encoding, so they can be combined (E(a)*E(b) etc.) without re-encoding
+#define ITHARE_OBF_MUL_INT(T,tag) ithare::obf::ObfMulInt<T,ithare::obf::obf_mul_seed(#tag)>
+
+#endif //ithare_obf_mul_h_included
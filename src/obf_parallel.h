@@ -0,0 +1,281 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_parallel_h_included
+#define ithare_obf_parallel_h_included
+
+//Parallel versions of obf_lib algorithms and transcoding, for bulk operations over large obfuscated datasets
+//  (such as re-encoding a server-side table of all player records)
+//  Work is split into chunks of ITHARE_OBF_PAR_CHUNK_BYTES; all chunk boundaries except for the very first one 
+//    are cache-line-aligned, so writers never share a cache line. Chunks are handed out dynamically via atomic counter, 
+//    and the calling thread participates too, so ObfThreadPool(1) has no worker threads at all
+//  Results are identical to serial obf_*_n() from impl/obf_lib_kernels.h: per-chunk results are combined in chunk order, 
+//    and obf_par_accumulate_n() requires integral accumulator (so that wrap-around addition is associative)
+//  NB: std::execution::par is not used, as with libstdc++ it silently depends on TBB
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include "obf.h"
+#include "impl/obf_lib_kernels.h"
+
+#ifndef ITHARE_OBF_PAR_CHUNK_BYTES
+#define ITHARE_OBF_PAR_CHUNK_BYTES (256*1024)
+#endif
+
+namespace ithare {
+	namespace obf {
+		class ObfThreadPool {
+			std::vector<std::thread> workers;
+			std::mutex mx;
+			std::condition_variable cv_start;
+			std::condition_variable cv_done;
+			const std::function<void(size_t)>* job = nullptr;//protected by mx
+			size_t job_nchunks = 0;//protected by mx
+			uint64_t generation = 0;//protected by mx
+			size_t nbusy = 0;//protected by mx
+			bool stopping = false;//protected by mx
+			std::atomic<size_t> next_chunk{0};
+
+			public:
+			explicit ObfThreadPool(size_t nthreads = std::max(1u, std::thread::hardware_concurrency())) {
+				assert(nthreads >= 1);
+				for (size_t i = 1; i < nthreads; ++i)
+					workers.emplace_back([this]() { worker_loop(); });
+			}
+			~ObfThreadPool() {
+				{
+					std::unique_lock<std::mutex> lock(mx);
+					stopping = true;
+				}
+				cv_start.notify_all();
+				for (auto& w : workers)
+					w.join();
+			}
+			ObfThreadPool(const ObfThreadPool&) = delete;
+			ObfThreadPool& operator =(const ObfThreadPool&) = delete;
+
+			size_t size() const {
+				return workers.size() + 1;
+			}
+
+			//for_each_chunk(): calls f(chunk) for each chunk in [0,nchunks), returns when all of them are done
+			//  NOT reentrant: f MUST NOT call for_each_chunk() of the same pool
+			void for_each_chunk(size_t nchunks, const std::function<void(size_t)>& f) {
+				if (workers.empty() || nchunks <= 1) {
+					for (size_t i = 0; i < nchunks; ++i)
+						f(i);
+					return;
+				}
+				{
+					std::unique_lock<std::mutex> lock(mx);
+					job = &f;
+					job_nchunks = nchunks;
+					next_chunk.store(0, std::memory_order_relaxed);
+					nbusy = workers.size();
+					++generation;
+				}
+				cv_start.notify_all();
+				run_chunks(f, nchunks);
+				std::unique_lock<std::mutex> lock(mx);
+				cv_done.wait(lock, [this]() { return nbusy == 0; });
+				job = nullptr;
+			}
+
+			private:
+			void run_chunks(const std::function<void(size_t)>& f, size_t nchunks) {
+				for (;;) {
+					size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+					if (chunk >= nchunks)
+						return;
+					f(chunk);
+				}
+			}
+			void worker_loop() {
+				uint64_t seen = 0;
+				for (;;) {
+					const std::function<void(size_t)>* f;
+					size_t nchunks;
+					{
+						std::unique_lock<std::mutex> lock(mx);
+						cv_start.wait(lock, [&]() { return stopping || generation != seen; });
+						if (stopping)
+							return;
+						seen = generation;
+						f = job;
+						nchunks = job_nchunks;
+					}
+					run_chunks(*f, nchunks);
+					bool last;
+					{
+						std::unique_lock<std::mutex> lock(mx);
+						last = --nbusy == 0;
+					}
+					if (last)
+						cv_done.notify_one();
+				}
+			}
+		};
+
+		//ObfParChunks<T>: chunk boundaries for an array of T
+		//  first chunk absorbs the misaligned head, so all the other boundaries fall on cache line boundaries
+		//  (if sizeof(T) doesn't divide cache line, alignment is not possible, and chunks are merely contiguous)
+		template<class T>
+		class ObfParChunks {
+			size_t n;
+			size_t chunk;
+			size_t head;
+
+			public:
+			ObfParChunks(const T* p, size_t n_)
+			: n(n_) {
+				constexpr size_t line_elems = obf_cache_line % sizeof(T) == 0 ? obf_cache_line / sizeof(T) : 1;
+				chunk = std::max(line_elems, ITHARE_OBF_PAR_CHUNK_BYTES / sizeof(T) / line_elems * line_elems);
+				size_t misalign = size_t(reinterpret_cast<uintptr_t>(p) % obf_cache_line);
+				head = line_elems > 1 && misalign % sizeof(T) == 0 ? ((obf_cache_line - misalign) % obf_cache_line) / sizeof(T) : 0;
+			}
+			size_t count() const {
+				if (n <= head + chunk)
+					return 1;
+				return 1 + (n - head - chunk + chunk - 1) / chunk;
+			}
+			size_t begin(size_t k) const {
+				return k == 0 ? 0 : std::min(n, head + k * chunk);
+			}
+			size_t end(size_t k) const {
+				return std::min(n, head + (k + 1) * chunk);
+			}
+		};
+
+		template<class R>
+		struct alignas(obf_cache_line) ObfParSlot {//per-chunk result, one cache line each to avoid false sharing
+			R value;
+		};
+
+		template<class T, class T2>
+		void obf_par_fill_n(ObfThreadPool& pool, T* to, size_t n, const T2& value) {
+			T enc = value;
+			ObfParChunks<T> chunks(to, n);
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				obf_fill_n(to + chunks.begin(k), chunks.end(k) - chunks.begin(k), enc);
+			});
+		}
+
+		template<class T, class T2>
+		size_t obf_par_find_n(ObfThreadPool& pool, const T* a, size_t n, const T2& value) {//returns n if not found
+			ObfParChunks<T> chunks(a, n);
+			std::atomic<size_t> found{n};//lowest found index so far; chunks entirely above it are skipped
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				size_t b = chunks.begin(k);
+				if (b >= found.load(std::memory_order_relaxed))
+					return;
+				size_t e = chunks.end(k);
+				size_t idx = b + obf_find_n(a + b, e - b, value);
+				if (idx < e) {
+					size_t prev = found.load(std::memory_order_relaxed);
+					while (idx < prev && !found.compare_exchange_weak(prev, idx, std::memory_order_relaxed))
+						;
+				}
+			});
+			return found.load(std::memory_order_relaxed);
+		}
+
+		template<class T, class T2>
+		size_t obf_par_count_n(ObfThreadPool& pool, const T* a, size_t n, const T2& value) {
+			ObfParChunks<T> chunks(a, n);
+			std::vector<ObfParSlot<size_t>> slots(chunks.count());
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				slots[k].value = obf_count_n(a + chunks.begin(k), chunks.end(k) - chunks.begin(k), value);
+			});
+			size_t ret = 0;
+			for (auto& s : slots)
+				ret += s.value;
+			return ret;
+		}
+
+		template<class T, class Acc>
+		Acc obf_par_accumulate_n(ObfThreadPool& pool, const T* a, size_t n, Acc init) {
+			static_assert(std::is_integral<Acc>::value, "floating-point accumulation would depend on chunking");
+			ObfParChunks<T> chunks(a, n);
+			std::vector<ObfParSlot<Acc>> slots(chunks.count());
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				slots[k].value = obf_accumulate_n(a + chunks.begin(k), chunks.end(k) - chunks.begin(k), Acc(0));
+			});
+			for (auto& s : slots)
+				init += s.value;
+			return init;
+		}
+
+		template<class T>
+		auto obf_par_minmax_n(ObfThreadPool& pool, const T* a, size_t n) {
+			assert(n > 0);
+			using MinMax = decltype(obf_minmax_n(a, n));
+			ObfParChunks<T> chunks(a, n);
+			std::vector<ObfParSlot<MinMax>> slots(chunks.count());
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				slots[k].value = obf_minmax_n(a + chunks.begin(k), chunks.end(k) - chunks.begin(k));
+			});
+			MinMax ret = slots[0].value;
+			for (auto& s : slots) {
+				ret.first = std::min(ret.first, s.value.first);
+				ret.second = std::max(ret.second, s.value.second);
+			}
+			return ret;
+		}
+
+		template<class T>
+		void obf_par_reverse_n(ObfThreadPool& pool, T* a, size_t n) {
+			size_t half = n / 2;
+			ObfParChunks<T> chunks(a, half);//chunking the lower half; each chunk swaps with its mirror 
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				for (size_t i = chunks.begin(k); i < chunks.end(k); ++i)
+					std::swap(a[i], a[n - 1 - i]);
+			});
+		}
+
+		//obf_par_transcode_n(): bulk re-encoding (e.g. whole table moved to a different OBFI?() type)
+		template<class From, class To>
+		void obf_par_transcode_n(ObfThreadPool& pool, const From* from, To* to, size_t n) {
+			ObfParChunks<To> chunks(to, n);//aligning by destination
+			pool.for_each_chunk(chunks.count(), [&](size_t k) {
+				size_t b = chunks.begin(k);
+				obf_transcode_n(from + b, to + b, chunks.end(k) - b);
+			});
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_parallel_h_included
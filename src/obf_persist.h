@@ -0,0 +1,167 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_persist_h_included
+#define ithare_obf_persist_h_included
+
+//Encoded persistence for save games/snapshots
+//  Stored form of each value is ObfStorageInjection<T> (x*MUL+ADD)^XOR mod 2^N, little-endian, 
+//    with constants derived from ITHARE_OBF_STORAGE_SEED (defaults to ITHARE_OBF_SEED)
+//    - using our own portable constexpr PRNG, so stored form doesn't depend on platform or compiler 
+//  Saving goes OBFI?(T) -> (surjection) -> storage injection, loading goes the other way; 
+//    plain value exists only in a register in between, and never gets to disk or into any buffer
+//  NB: if you want saves to survive rebuilds with a new ITHARE_OBF_SEED, specify ITHARE_OBF_STORAGE_SEED explicitly, 
+//      and change it only when you're ready to invalidate all the saves 
+//  Bulk obf_persist_save()/obf_persist_load() are simple per-element loops, to allow compiler to vectorize them 
+//    whenever surjection/injection of OBFI?(T) allows 
+//  obf_persist_save_blob()/obf_persist_load_blob() add a header and CRC32C, so that blobs stored under a different key 
+//    (another ITHARE_OBF_STORAGE_SEED), for a different number of values, or corrupted, are rejected instead of being loaded as garbage
+//  All the functions take storage key as an optional template parameter (defaults to ITHARE_OBF_STORAGE_SEED); 
+//    key == 0 means no storage encoding (stored form is plain little-endian), which is what non-obfuscated builds use
+
+#include <assert.h>
+#include <string.h>
+#include "obf.h"
+#include "obf_checksum.h"
+
+#if !defined(ITHARE_OBF_STORAGE_SEED) && defined(ITHARE_OBF_SEED)
+#define ITHARE_OBF_STORAGE_SEED ITHARE_OBF_SEED
+#endif
+
+namespace ithare {
+	namespace obf {
+#ifdef ITHARE_OBF_STORAGE_SEED
+		constexpr uint64_t obf_persist_default_key = uint64_t(ITHARE_OBF_STORAGE_SEED);
+#else
+		constexpr uint64_t obf_persist_default_key = 0;
+#endif
+
+		template<class UT>//to avoid integral promotion of small unsigned types into (overflowing) signed int 
+		using ObfPersistWideT = typename std::conditional<(sizeof(UT) < sizeof(unsigned)), unsigned, UT>::type;
+
+		template<class T, uint64_t key = obf_persist_default_key>
+		struct ObfStorageInjection {
+			static_assert(std::is_integral<T>::value);
+			using UT = typename std::make_unsigned<T>::type;
+			using WT = ObfPersistWideT<UT>;
+			static constexpr uint64_t seed = key ^ sizeof(T);//different constants for different widths
+			static constexpr UT MUL = key ? UT(obf_splitmix64(seed)) | 1 : 1;
+			static constexpr UT ADD = key ? UT(obf_splitmix64(seed + 1)) : 0;
+			static constexpr UT XOR = key ? UT(obf_splitmix64(seed + 2)) : 0;
+			static constexpr UT MULINV = obf_mul_inverse<UT>(MUL);
+			static_assert(UT(WT(MUL) * WT(MULINV)) == 1);
+
+			ITHARE_OBF_FORCEINLINE static void store(T x, uint8_t* out) {
+				UT y = UT(UT(WT(UT(x)) * WT(MUL) + WT(ADD)) ^ XOR);
+				for (size_t i = 0; i < sizeof(T); ++i)//little-endian regardless of platform; folded into a single mov on LE platforms
+					out[i] = uint8_t(y >> (i * 8));
+			}
+			ITHARE_OBF_FORCEINLINE static T load(const uint8_t* in) {
+				UT y = 0;
+				for (size_t i = 0; i < sizeof(T); ++i)
+					y |= UT(UT(in[i]) << (i * 8));
+				return T(UT(WT(UT(WT(UT(y ^ XOR)) - WT(ADD))) * WT(MULINV)));
+			}
+		};
+
+		template<class ObfT>
+		constexpr size_t obf_persist_size() {//stored size of one value
+			return sizeof(typename ObfSizeofReport<ObfT>::plain_type);
+		}
+
+		template<uint64_t key = obf_persist_default_key, class ObfT>
+		ITHARE_OBF_FORCEINLINE void obf_persist_save_one(const ObfT& x, uint8_t* out) {
+			using T = typename ObfSizeofReport<ObfT>::plain_type;
+			ObfStorageInjection<T,key>::store(T(x), out);
+		}
+		template<uint64_t key = obf_persist_default_key, class ObfT>
+		ITHARE_OBF_FORCEINLINE void obf_persist_load_one(const uint8_t* in, ObfT& x) {
+			using T = typename ObfSizeofReport<ObfT>::plain_type;
+			x = ObfStorageInjection<T,key>::load(in);
+		}
+
+		template<uint64_t key = obf_persist_default_key, class ObfT>
+		void obf_persist_save(const ObfT* values, size_t n, uint8_t* out) {//out MUST have n*obf_persist_size<ObfT>() bytes
+			constexpr size_t sz = obf_persist_size<ObfT>();
+			for (size_t i = 0; i < n; ++i)
+				obf_persist_save_one<key>(values[i], out + i * sz);
+		}
+		template<uint64_t key = obf_persist_default_key, class ObfT>
+		void obf_persist_load(const uint8_t* in, size_t n, ObfT* values) {
+			constexpr size_t sz = obf_persist_size<ObfT>();
+			for (size_t i = 0; i < n; ++i)
+				obf_persist_load_one<key>(in + i * sz, values[i]);
+		}
+
+		//blob: magic(4) key_tag(4) n(4) values(n*obf_persist_size<ObfT>()) crc32c(4); all little-endian, CRC32C is over everything before it
+		constexpr uint32_t obf_persist_blob_magic = UINT32_C(0x5046'424f);//"OBFP"
+		constexpr size_t obf_persist_blob_overhead = 16;
+		template<uint64_t key>
+		constexpr uint32_t obf_persist_key_tag() {//identifies the key without revealing storage constants
+			return uint32_t(obf_splitmix64(key ^ UINT64_C(0x7c1f'53a9'e04b'2d86)) >> 32);
+		}
+		template<class ObfT>
+		constexpr size_t obf_persist_blob_size(size_t n) {
+			return obf_persist_blob_overhead + n * obf_persist_size<ObfT>();
+		}
+		inline void obf_persist_write32(uint8_t* p, uint32_t x) {//little-endian
+			for (size_t i = 0; i < 4; ++i)
+				p[i] = uint8_t(x >> (i * 8));
+		}
+
+		template<uint64_t key = obf_persist_default_key, class ObfT>
+		void obf_persist_save_blob(const ObfT* values, size_t n, uint8_t* out) {//out MUST have obf_persist_blob_size<ObfT>(n) bytes
+			assert(n <= UINT32_MAX);
+			obf_persist_write32(out, obf_persist_blob_magic);
+			obf_persist_write32(out + 4, obf_persist_key_tag<key>());
+			obf_persist_write32(out + 8, uint32_t(n));
+			obf_persist_save<key>(values, n, out + 12);
+			size_t sz = obf_persist_blob_size<ObfT>(n) - 4;
+			obf_persist_write32(out + sz, obf_crc32c_bytes(out, sz));
+		}
+		template<uint64_t key = obf_persist_default_key, class ObfT>
+		bool obf_persist_load_blob(const uint8_t* in, size_t insz, size_t n, ObfT* values) {
+			//returns false (leaving values untouched) if the blob has wrong size, magic, key or n, or CRC32C doesn't match
+			if (insz != obf_persist_blob_size<ObfT>(n))
+				return false;
+			if (obf_checksum_read32(in) != obf_persist_blob_magic || obf_checksum_read32(in + 4) != obf_persist_key_tag<key>() || obf_checksum_read32(in + 8) != n)
+				return false;
+			size_t sz = insz - 4;
+			if (obf_crc32c_bytes(in, sz) != obf_checksum_read32(in + sz))
+				return false;
+			obf_persist_load<key>(in + 12, n, values);
+			return true;
+		}
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_persist_h_included
@@ -0,0 +1,104 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_rng_h_included
+#define ithare_obf_rng_h_included
+
+//ObfRng<OBFI?(uint64_t)>: xoshiro256** (https://prng.di.unimi.it/) with state words stored encoded
+//  loot/crit RNG state is a classic bot target: with plain state, a few observed outputs are enough to find it in memory
+//  Each step decodes four state words (four independent chains, so they go in parallel), 
+//    runs plain xoshiro256** step in registers, and re-encodes; generate() does it once per batch, 
+//    so that state in memory is encoded at all times, and plain state exists in registers only
+//  NB: xoshiro's step is GF(2)-linear, but kscope injections are not, so running the step in injected domain directly is not possible
+//  Satisfies UniformRandomBitGenerator, so it can be used with std::uniform_int_distribution<> etc.
+//  Output sequence is the same as that of reference xoshiro256** seeded with SplitMix64(seed) 
+
+#include <limits>
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+		template<class ObfT>
+		class ObfRng {
+			static_assert(std::is_same<typename ObfSizeofReport<ObfT>::plain_type, uint64_t>::value, "ObfRng<> requires OBFI?(uint64_t)");
+			ObfT s[4];
+
+			public:
+			using result_type = uint64_t;
+
+			explicit ObfRng(uint64_t seed) {
+				for (int i = 0; i < 4; ++i)//SplitMix64 never gives all-zero state
+					s[i] = obf_splitmix64(seed + uint64_t(i) * UINT64_C(0x9e37'79b9'7f4a'7c15));
+			}
+			static constexpr result_type min() {
+				return 0;
+			}
+			static constexpr result_type max() {
+				return std::numeric_limits<uint64_t>::max();
+			}
+
+			result_type operator()() {
+				uint64_t s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+				uint64_t ret = step(s0, s1, s2, s3);
+				s[0] = s0; s[1] = s1; s[2] = s2; s[3] = s3;
+				return ret;
+			}
+
+			//generate(): n numbers in one go; OutT can be either uint64_t or OBFI?(uint64_t)
+			template<class OutT>
+			void generate(OutT* out, size_t n) {
+				uint64_t s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+				for (size_t i = 0; i < n; ++i)
+					out[i] = step(s0, s1, s2, s3);
+				s[0] = s0; s[1] = s1; s[2] = s2; s[3] = s3;
+			}
+
+			private:
+			static ITHARE_OBF_FORCEINLINE uint64_t rotl(uint64_t x, int k) {
+				return (x << k) | (x >> (64 - k));
+			}
+			static ITHARE_OBF_FORCEINLINE uint64_t step(uint64_t& s0, uint64_t& s1, uint64_t& s2, uint64_t& s3) {
+				uint64_t ret = rotl(s1 * 5, 7) * 9;
+				uint64_t t = s1 << 17;
+				s2 ^= s0;
+				s3 ^= s1;
+				s1 ^= s2;
+				s0 ^= s3;
+				s2 ^= t;
+				s3 = rotl(s3, 45);
+				return ret;
+			}
+		};
+	}//namespace obf
+}//namespace ithare 
+
+#endif //ithare_obf_rng_h_included
@@ -0,0 +1,223 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ithare_obf_struct_h_included
+#define ithare_obf_struct_h_included
+
+//ObfStruct<>: struct with field order permuted per seed, while keeping hot fields together
+//  fixed field order gives reverse engineers stable offsets; shuffling fields by hand breaks cache locality
+//  Usage:
+//    using Entity = ITHARE_OBF_STRUCT(Entity,
+//      ithare::obf::ObfField<struct entity_x, OBFI3(int32_t), true>,//true == hot
+//      ithare::obf::ObfField<struct entity_name, char[48]>,
+//      ithare::obf::ObfField<struct entity_y, OBFI3(int32_t), true>);
+//    Entity e; e.get<entity_x>() += 1;
+//  Layout is planned at compile time: hot fields go first (all of them within one cache line, 
+//    as ObfStruct<> is aligned to next power of 2 above the size of hot group, up to cache line), cold ones follow; 
+//    within each group, order is a seed-driven permutation. get<>() is a fixed offset, same as for a usual member 
+//  Without ITHARE_OBF_SEED, order is the same as in source (hot fields still go first)
+//  The first parameter of ITHARE_OBF_STRUCT() is a tag (any identifier) which, together with ITHARE_OBF_SEED, determines the layout;
+//    it MUST be the same in all TUs using the type (which holds if the type is defined once in a header), 
+//    and SHOULD be unique across the project (structs with the same tag and the same fields get the same layout)
+//    NB: NEVER seed from __LINE__/__COUNTER__ - they depend on the TU, so the same header would produce different layouts (ODR/ABI violation)
+//  NB: fields MUST be trivially copyable and trivially destructible (which holds for OBFI?() and plain types); 
+//      fields are value-initialized on construction 
+
+#include <utility>
+#include <tuple>
+#include <new>
+#include "obf.h"
+
+namespace ithare {
+	namespace obf {
+		template<class Tag, class T, bool hot_ = false>
+		struct ObfField {
+			using tag = Tag;
+			using type = T;
+			static constexpr bool hot = hot_;
+		};
+
+		template<size_t n>
+		struct ObfStructPlan {
+			size_t offset[n];
+			size_t hot_size;
+			size_t size;
+			size_t align;
+		};
+
+		template<uint64_t seed, class... Fields>
+		struct ObfStructLayout {
+			static constexpr size_t n = sizeof...(Fields);
+			static_assert(n > 0);
+			static constexpr size_t sizes[n] = { sizeof(typename Fields::type)... };
+			static constexpr size_t aligns[n] = { alignof(typename Fields::type)... };
+			static constexpr bool hots[n] = { Fields::hot... };
+
+			static constexpr size_t place(const size_t (&order)[n], size_t from, size_t to, size_t start, size_t (&offset)[n]) {
+				size_t pos = start;
+				for (size_t i = from; i < to; ++i) {
+					size_t f = order[i];
+					pos = (pos + aligns[f] - 1) / aligns[f] * aligns[f];
+					offset[f] = pos;
+					pos += sizes[f];
+				}
+				return pos;
+			}
+			static constexpr void permute(size_t (&order)[n], size_t from, size_t to, uint64_t rnd) {//Fisher-Yates
+				for (size_t i = to; i > from + 1; --i) {
+					rnd = obf_splitmix64(rnd);
+					size_t j = from + rnd % (i - from);
+					size_t tmp = order[i - 1];
+					order[i - 1] = order[j];
+					order[j] = tmp;
+				}
+			}
+			static constexpr void sort_by_align(size_t (&order)[n], size_t from, size_t to) {//stable, descending; minimizes padding
+				for (size_t i = from + 1; i < to; ++i)
+					for (size_t j = i; j > from && aligns[order[j]] > aligns[order[j - 1]]; --j) {
+						size_t tmp = order[j];
+						order[j] = order[j - 1];
+						order[j - 1] = tmp;
+					}
+			}
+
+			static constexpr ObfStructPlan<n> plan() {
+				ObfStructPlan<n> ret = {};
+				size_t order[n] = {};
+				size_t nhot = 0;
+				for (size_t i = 0; i < n; ++i)//hot first, in source order
+					if (hots[i])
+						order[nhot++] = i;
+				size_t k = nhot;
+				for (size_t i = 0; i < n; ++i)
+					if (!hots[i])
+						order[k++] = i;
+
+				size_t hot_size = 0;
+				if constexpr(seed != 0) {
+					//hot group: random permutations until one fits into cache line without excessive padding; 
+					//  falling back to alignment-sorted order (which has minimal padding)
+					bool fits = false;
+					for (uint64_t attempt = 0; attempt < 16 && !fits; ++attempt) {
+						permute(order, 0, nhot, seed + attempt);
+						hot_size = place(order, 0, nhot, 0, ret.offset);
+						fits = hot_size <= obf_cache_line;
+					}
+					if (!fits)
+						sort_by_align(order, 0, nhot);
+					permute(order, nhot, n, ~seed);
+				}
+				hot_size = place(order, 0, nhot, 0, ret.offset);
+				size_t end = place(order, nhot, n, hot_size, ret.offset);
+
+				size_t align = 1;
+				for (size_t i = 0; i < n; ++i)
+					align = aligns[i] > align ? aligns[i] : align;
+				while (align < hot_size && align < obf_cache_line)
+					align *= 2;
+				ret.hot_size = hot_size;
+				ret.align = align;
+				ret.size = (end + align - 1) / align * align;
+				return ret;
+			}
+			static constexpr ObfStructPlan<n> value = plan();
+			static_assert(value.hot_size <= obf_cache_line, "hot fields of ObfStruct<> don't fit into one cache line");
+		};
+
+		template<class Tag, class... Fields>
+		constexpr size_t obf_struct_field_index() {
+			constexpr bool same[] = { std::is_same<Tag, typename Fields::tag>::value... };
+			size_t ret = sizeof...(Fields);
+			for (size_t i = 0; i < sizeof...(Fields); ++i)
+				if (same[i]) {
+					assert(ret == sizeof...(Fields));//duplicate tags
+					ret = i;
+				}
+			return ret;
+		}
+
+		template<uint64_t seed, class... Fields>
+		class ObfStruct {
+			using Layout = ObfStructLayout<seed, Fields...>;
+			static_assert((std::is_trivially_copyable<typename Fields::type>::value && ...));
+			static_assert((std::is_trivially_destructible<typename Fields::type>::value && ...));
+
+			alignas(Layout::value.align) unsigned char storage[Layout::value.size];
+
+			template<class Tag>
+			static constexpr size_t index() {
+				constexpr size_t ret = obf_struct_field_index<Tag, Fields...>();
+				static_assert(ret < sizeof...(Fields), "no such field in ObfStruct<>");
+				return ret;
+			}
+			template<size_t... I>
+			void construct(std::index_sequence<I...>) {
+				(new(storage + Layout::value.offset[I]) typename Fields::type(), ...);
+			}
+
+			public:
+			ObfStruct() {
+				construct(std::index_sequence_for<Fields...>());
+			}
+
+			template<class Tag>
+			using field_type = typename std::tuple_element<index<Tag>(), std::tuple<typename Fields::type...>>::type;
+
+			template<class Tag>
+			static constexpr size_t offset_of() {
+				return Layout::value.offset[index<Tag>()];
+			}
+			template<class Tag>
+			ITHARE_OBF_FORCEINLINE field_type<Tag>& get() {
+				return *std::launder(reinterpret_cast<field_type<Tag>*>(storage + offset_of<Tag>()));
+			}
+			template<class Tag>
+			ITHARE_OBF_FORCEINLINE const field_type<Tag>& get() const {
+				return *std::launder(reinterpret_cast<const field_type<Tag>*>(storage + offset_of<Tag>()));
+			}
+		};
+
+#ifdef ITHARE_OBF_SEED
+		constexpr uint64_t obf_struct_seed(const char* tag) {
+			return obf_splitmix64(uint64_t(ITHARE_OBF_SEED) ^ obf_tag_hash(tag)) | 1;//never 0 
+		}
+#else
+		constexpr uint64_t obf_struct_seed(const char*) {
+			return 0;
+		}
+#endif
+	}//namespace obf
+}//namespace ithare 
+
+#define ITHARE_OBF_STRUCT(tag,...) ithare::obf::ObfStruct<ithare::obf::obf_struct_seed(#tag),__VA_ARGS__>
+
+#endif //ithare_obf_struct_h_included
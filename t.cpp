@@ -0,0 +1,16 @@
+#include "obf_rekey.h"
+#include <cstdio>
+using namespace ithare::obf;
+int main(){
+  std::vector<ObfRekeyable<uint32_t>> small; std::vector<ObfRekeyable<uint64_t>> big;
+  for (uint32_t i=0;i<100;++i){ small.emplace_back(i*40503u); big.emplace_back(uint64_t(i)*UINT64_C(0x9e3779b97f4a7c15)); }
+  bool ok=true; long iters=0;
+  for (int pass=0; pass<10; ++pass) {
+    while (obf_rekey_step(7)!=0 && ok) {
+      small.pop_back(); small.emplace_back(uint32_t(small.size())*40503u);
+      for (uint32_t i=0;i<100;++i) ok = ok && uint32_t(small[i].get())==i*40503u && uint64_t(big[i].get())==uint64_t(i)*UINT64_C(0x9e3779b97f4a7c15);
+      if (++iters > 1000000) { printf("still looping after %ld iters, ok=%d\n", iters, ok); return 1; }
+    }
+  }
+  printf("done ok=%d iters=%ld\n", ok, iters);
+}
@@ -0,0 +1,62 @@
+# no shebang - don't want to change current shell 
+
+# Copyright (c) 2018, ITHare.com
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of source code must retain the above copyright notice, this
+#  list of conditions and the following disclaimer.
+# 
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# * Neither the name of the copyright holder nor the names of its
+#   contributors may be used to endorse or promote products derived from
+#   this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Static per-site cost audit: compiles audited sites (obfmcaaudit.cpp with -DITHARE_OBF_MCA_SITES) into assembly with llvm-mca markers, 
+#   and fails if any of the marked sites exceeds its OBFX() budget by more than FACTOR times
+# Usage: mcaaudit.sh [seed [factor]]
+
+seed=0x4b295ebab3333abc
+if [ $# -gt 0 ]; then
+  seed=$1
+fi
+factor="${FACTOR:=2}"
+if [ $# -gt 1 ]; then
+  factor=$2
+fi
+
+CXX="${CXX:=g++}"
+MCA="${MCA:=llvm-mca}"
+
+$CXX -O2 -o obfmcaaudit -std=c++1z -lstdc++ ../obfmcaaudit.cpp
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
+$CXX -O3 -DNDEBUG -S -o obfmcasites.s -std=c++1z -DITHARE_OBF_SEED=$seed -DITHARE_OBF_DBG_MCA_MARKERS -DITHARE_OBF_MCA_SITES ../obfmcaaudit.cpp
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
+./obfmcaaudit -factor $factor -mca $MCA obfmcasites.s
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
+rm obfmcasites.s
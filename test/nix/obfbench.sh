@@ -0,0 +1,52 @@
+# no shebang - don't want to change current shell 
+
+# Copyright (c) 2018, ITHare.com
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of source code must retain the above copyright notice, this
+#  list of conditions and the following disclaimer.
+# 
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# * Neither the name of the copyright holder nor the names of its
+#   contributors may be used to endorse or promote products derived from
+#   this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Builds and runs obf microbenchmarks (obfbench.cpp)
+# Usage: obfbench.sh [seed]
+
+seed=0x4b295ebab3333abc
+if [ $# -gt 0 ]; then
+  seed=$1
+fi
+
+CXX="${CXX:=g++}"
+
+$CXX -O3 -DNDEBUG -o obfbench -std=c++1z -lstdc++ -DITHARE_OBF_SEED=$seed ../obfbench.cpp -latomic
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
+./obfbench
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
+# code size of hot functions with inline vs outlined (OBFS?L_COLD()) literal decoders
+nm -S -C --size-sort obfbench | grep "bench_cold_literal"
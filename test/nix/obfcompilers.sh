@@ -0,0 +1,166 @@
+# no shebang - don't want to change current shell 
+
+# Copyright (c) 2018, ITHare.com
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of source code must retain the above copyright notice, this
+#  list of conditions and the following disclaimer.
+# 
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# * Neither the name of the copyright holder nor the names of its
+#   contributors may be used to endorse or promote products derived from
+#   this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Builds obf microbenchmarks (obfbench.cpp) with every installed GCC and Clang for the same seed, 
+#   and reports per-kernel timings, code size, and stack traffic side by side
+# Usage: obfcompilers.sh [seed]
+#   seed=none builds without ITHARE_OBF_SEED (plain baseline)
+# Environment:
+#   OBF_COMPILERS="g++-12 clang++-15" to use specific compilers instead of auto-detected ones
+#   CPU_GHZ=3.6 to report cycles instead of ns (ideally, with frequency scaling disabled)
+#   OBF_NBENCH=1000000 to run fewer iterations per benchmark
+
+seed=0x4b295ebab3333abc
+if [ $# -gt 0 ]; then
+  seed=$1
+fi
+seeddef="-DITHARE_OBF_SEED=$seed"
+if [ "$seed" = "none" ]; then
+  seeddef=""
+fi
+nbenchdef=""
+if [ -n "$OBF_NBENCH" ]; then
+  nbenchdef="-DNBENCH=$OBF_NBENCH"
+fi
+
+if [ -z "$OBF_COMPILERS" ]; then
+  seen=""
+  for c in g++ $(seq -f "g++-%g" 5 20) clang++ $(seq -f "clang++-%g" 3 25); do
+    p=$(command -v $c 2>/dev/null)
+    if [ -n "$p" ]; then
+      real=$(readlink -f $p)
+      case " $seen " in
+        *" $real "*) ;;
+        *) seen="$seen $real"; OBF_COMPILERS="$OBF_COMPILERS $c" ;;
+      esac
+    fi
+  done
+fi
+
+built=""
+for c in $OBF_COMPILERS; do
+  echo "=== $c: $($c --version | head -1)"
+  $c -O3 -DNDEBUG -o obfbench-$c -std=c++1z -lstdc++ $seeddef $nbenchdef ../obfbench.cpp -latomic -lpthread
+  if [ ! $? -eq 0 ]; then
+    echo "$c: build FAILED, skipping"
+    continue
+  fi
+  ./obfbench-$c > obfbench-$c.txt
+  if [ ! $? -eq 0 ]; then
+    echo "$c: run FAILED, skipping"
+    continue
+  fi
+  # per-site code size (bytes) and stack traffic (instructions addressing %rsp/%rbp) of benchmark functions, tab-separated
+  objdump -d --no-show-raw-insn -C obfbench-$c | awk '
+    function hex(s,    i, v) {  # no strtonum() in mawk
+      v = 0
+      for (i = 1; i <= length(s); ++i)
+        v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+      return v
+    }
+    /^[0-9a-f]+ <.*>:$/ {
+      if (name != "" && name ~ /bench/) print name "\t" (last - first) "\t" spills
+      name = substr($0, index($0, "<") + 1); name = substr(name, 1, length(name) - 2)
+      first = hex($1); last = first; spills = 0; next
+    }
+    /^ *[0-9a-f]+:\t/ {
+      split($1, a, ":"); last = hex(a[1])
+      if ($0 ~ /\(%[re](sp|bp)\)/) spills++
+    }
+    END { if (name != "" && name ~ /bench/) print name "\t" (last - first) "\t" spills }
+  ' > obfbench-$c.sites
+  built="$built $c"
+done
+
+if [ -z "$built" ]; then
+  echo "no compiler succeeded"
+  exit 1
+fi
+
+# timings: obfbench prints names in a 48-char column, followed by value and unit
+echo
+echo "=== timings$([ -n "$CPU_GHZ" ] && echo " (cycles, at $CPU_GHZ GHz)")"
+awk -v ghz="$CPU_GHZ" -v compilers="$built" '
+  BEGIN { n = split(compilers, cc, " ") }
+  FNR == 1 { file++ }
+  /^---/ { key = ""; if (file == 1) order[++nkeys] = $0; next }
+  length($0) > 48 {
+    if (substr($0, 48, 1) != " ") next  # not a name-in-48-char-column line
+    key = substr($0, 1, 48); rest = substr($0, 49); split(rest, f, " ")
+    if (f[1] !~ /^-?[0-9.]+$/) next
+    v = f[1]; unit = rest; sub(/^ *[^ ]+ +/, "", unit)  # unit may contain spaces ("M numbers/s")
+    if (ghz != "" && unit ~ /^ns/) { v = sprintf("%.1f", v * ghz); unit = "cycles" substr(unit, 3) }
+    if (file == 1) { order[++nkeys] = key; units[key] = unit }
+    val[key, file] = v
+  }
+  END {
+    printf "%-48s", ""; for (i = 1; i <= n; ++i) printf "%14s", cc[i]; printf "\n"
+    for (k = 1; k <= nkeys; ++k) {
+      key = order[k]
+      if (key ~ /^---/) { print key; continue }
+      printf "%-48s", key
+      for (i = 1; i <= n; ++i) printf "%14s", ((key, i) in val) ? val[key, i] : "-"
+      printf "  %s\n", units[key]
+    }
+  }' $(for c in $built; do echo obfbench-$c.txt; done)
+
+# code size and stack traffic; sites where a compiler has both >=4 stack accesses and >=2x of the best compiler's count 
+#   are the ones where it failed to keep the obfuscation chain in registers
+echo
+echo "=== code size (bytes) / stack accesses per benchmark site"
+awk -F '\t' -v compilers="$built" '
+  BEGIN { n = split(compilers, cc, " ") }
+  FNR == 1 { file++ }
+  {
+    if (!($1 in seen)) { seen[$1] = 1; order[++nkeys] = $1 }
+    size[$1, file] = $2; spills[$1, file] = $3
+  }
+  END {
+    for (i = 1; i <= n; ++i) printf "%16s", cc[i]; printf "  site\n"
+    for (k = 1; k <= nkeys; ++k) {
+      s = order[k]; best = -1
+      for (i = 1; i <= n; ++i)
+        if ((s, i) in spills && (best < 0 || spills[s, i] < best)) best = spills[s, i]
+      line = ""; flag = ""
+      for (i = 1; i <= n; ++i) {
+        if ((s, i) in size) {
+          line = line sprintf("%16s", size[s, i] "/" spills[s, i])
+          if (spills[s, i] >= 4 && spills[s, i] >= 2 * best)
+            flag = flag " " cc[i]
+        }
+        else
+          line = line sprintf("%16s", "-")
+      }
+      line = line "  " s
+      if (flag != "")
+        line = line "  <-- stack-bound:" flag
+      print line
+    }
+  }' $(for c in $built; do echo obfbench-$c.sites; done)
@@ -0,0 +1,81 @@
+# no shebang - don't want to change current shell 
+
+# Copyright (c) 2018, ITHare.com
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of source code must retain the above copyright notice, this
+#  list of conditions and the following disclaimer.
+# 
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# * Neither the name of the copyright holder nor the names of its
+#   contributors may be used to endorse or promote products derived from
+#   this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Measures obftest run time in -O0 (debug) builds: plain (no seed), obfuscated, and obfuscated with ITHARE_OBF_DEBUG_PERF
+# Usage: obfdebugbench.sh [seed] [optlevel]
+#   optlevel defaults to -O0; -Og is the other intended use case
+
+seed=0x4b295ebab3333abc
+if [ $# -gt 0 ]; then
+  seed=$1
+fi
+opt=-O0
+if [ $# -gt 1 ]; then
+  opt=$2
+fi
+
+CXX="${CXX:=g++}"
+KSCOPETEST=../../../kscope/test
+EXT="-DITHARE_KSCOPE_TEST_EXTENSION=\"../../obf/src/kscope_extension_for_obf.h\""
+
+# $1: executable name, $2: kscope defines, $3: obf defines
+build() {
+  $CXX -c $opt -g -std=c++1z $EXT $2 $KSCOPETEST/officialtest.cpp $KSCOPETEST/chachatest.cpp
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  $CXX -c $opt -g -std=c++1z -pthread $EXT $3 ../obftest.cpp
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  $CXX -o $1 officialtest.o chachatest.o obftest.o -lstdc++ -pthread -latomic
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+}
+
+# $1: executable name
+run() {
+  start=$(date +%s%N)
+  ./$1 > /dev/null
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  end=$(date +%s%N)
+  echo "$1 ($opt): $(( (end - start) / 1000000 )) ms"
+}
+
+build obftest-plain "" ""
+build obftest-obf "-DITHARE_KSCOPE_SEED=$seed" "-DITHARE_OBF_SEED=$seed"
+build obftest-obf-debugperf "-DITHARE_KSCOPE_SEED=$seed" "-DITHARE_OBF_SEED=$seed -DITHARE_OBF_DEBUG_PERF"
+
+run obftest-plain
+run obftest-obf
+run obftest-obf-debugperf
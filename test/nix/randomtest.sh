@@ -48,11 +48,18 @@ if [ ! $? -eq 0 ]; then
   exit 1
 fi
 
+# plaintext leak scanner (see ../obfleakscan.cpp): run once at the end of the session over all obfuscated executables
+$CXX -O2 -o obfleakscan -std=c++1z -lstdc++ ../obfleakscan.cpp -lpthread
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
 ./randomtestgen -add32tests $gen_sh $nn >generatedrandomtest.sh
 if [ ! $? -eq 0 ]; then
   exit 1
 fi
 
+rm -f randomtest-obf-* obfleakscan.lst
 chmod 700 generatedrandomtest.sh
 ./generatedrandomtest.sh
 if [ ! $? -eq 0 ]; then
@@ -60,3 +67,46 @@ if [ ! $? -eq 0 ]; then
 fi
 
 rm generatedrandomtest.sh
+
+./randomtestgen -leakscan >generatedleakscan.sh
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+chmod 700 generatedleakscan.sh
+./generatedleakscan.sh
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+rm generatedleakscan.sh randomtest-obf-* obfleakscan.lst
+
+# benchmark results store (see ../obfbenchdb.cpp): obfbench with a fixed seed, OBF_BENCH_RUNS times (0 to skip), 
+#   appended to OBF_BENCH_DB; to check for regressions: ./obfbenchdb compare obfbench.jsonl <base-commit> <new-commit>
+runs="${OBF_BENCH_RUNS:=5}"
+if [ $runs -gt 0 ]; then
+  benchdb="${OBF_BENCH_DB:=obfbench.jsonl}"
+  benchseed=0x4b295ebab3333abc
+  benchflags="-O3 -DNDEBUG"
+  commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+  git diff --quiet HEAD 2>/dev/null || commit="$commit+dirty"
+  compiler=$($CXX --version | head -1)
+
+  $CXX -O2 -o obfbenchdb -std=c++1z -lstdc++ ../obfbenchdb.cpp
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  $CXX $benchflags -o obfbench -std=c++1z -lstdc++ -DITHARE_OBF_SEED=$benchseed ../obfbench.cpp -latomic -lpthread
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  for run in $(seq 1 $runs); do
+    ./obfbench >obfbench-run.txt
+    if [ ! $? -eq 0 ]; then
+      exit 1
+    fi
+    ./obfbenchdb append $benchdb "$commit" $benchseed "$compiler" "$benchflags" $run obfbench-run.txt
+    if [ ! $? -eq 0 ]; then
+      exit 1
+    fi
+  done
+  rm obfbench-run.txt
+fi
@@ -0,0 +1,71 @@
+# no shebang - don't want to change current shell 
+
+# Copyright (c) 2018, ITHare.com
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of source code must retain the above copyright notice, this
+#  list of conditions and the following disclaimer.
+# 
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# * Neither the name of the copyright holder nor the names of its
+#   contributors may be used to endorse or promote products derived from
+#   this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+# Total time of a randomtest session, with one TU per test source vs unity builds (randomtestgen -unity)
+# Usage: unitybench.sh [nn]  (nn=256 by default)
+#   NB: each session gets its own random configurations, so differences below ~5% are noise
+
+gen_sh=""
+if [ -z ${BASH_VERSINFO[0]} ]; then
+gen_sh="-gen_sh"
+fi
+if [ ${BASH_VERSINFO[0]} -lt 4 ]; then
+gen_sh="-gen_sh"
+fi
+
+nn=256
+if [ $# -gt 0 ]; then
+  nn=$1
+fi
+
+CXX="${CXX:=g++}"
+
+$CXX -O2 -o randomtestgen -std=c++1z -lstdc++ ../randomtestgen.cpp
+if [ ! $? -eq 0 ]; then
+  exit 1
+fi
+
+for mode in "" "-unity"; do
+  ./randomtestgen -add32tests $gen_sh $mode $nn >generatedunitybench.sh
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  chmod 700 generatedunitybench.sh
+  start=$(date +%s)
+  ./generatedunitybench.sh >/dev/null
+  if [ ! $? -eq 0 ]; then
+    exit 1
+  fi
+  end=$(date +%s)
+  echo "randomtest session, nn=$nn${mode:+, $mode}: $((end - start)) s"
+done
+
+rm generatedunitybench.sh
@@ -0,0 +1,1096 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+//OBF MICROBENCHMARKS. Built as a separate executable (see nix/obfbench.sh), NOT a part of randomtest
+//  all the numbers are wall-clock, and are meaningful only for relative comparisons within the same run
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+#include "../src/obf.h"
+#include "../src/obf_log.h"
+#include "../src/obf_dump.h"
+#include "../src/obf_persist.h"
+#include "../src/obf_delta.h"
+#include "../src/obf_config.h"
+#include "../src/obf_parallel.h"
+#include "../src/obf_checksum.h"
+#include "../src/obf_rng.h"
+#include "../src/obf_arena.h"
+#include "../src/obf_struct.h"
+#include "../src/obf_mul.h"
+#include "../src/obf_div.h"
+#include "../src/impl/obf_lib_kernels.h"//benchmarks measure obf_*_n() kernels directly, without obf_lib.h wrappers
+
+#ifndef NBENCH
+#define NBENCH 10'000'000
+#endif
+
+#ifdef ITHARE_OBF_TEST_NO_NAMESPACE
+using namespace ithare::obf;
+#define ITOBF
+#else
+#define ITOBF ithare::obf::
+#endif
+
+template<class F>
+ITHARE_OBF_NOINLINE double obf_bench_ns_per_op(F f, size_t n = NBENCH) {
+	f(n/16);//warm-up
+	auto started = std::chrono::high_resolution_clock::now();
+	f(n);
+	auto elapsed = std::chrono::high_resolution_clock::now() - started;
+	return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / double(n);
+}
+
+//ALL the results go through obf_bench_report(), in one format which obfbenchdb.cpp parses: name in 48 columns, value, unit;
+//  informational lines (which are not results) are indented, so obfbenchdb can tell them from malformed result lines
+static void obf_bench_report(const std::string& name, double value, const char* unit = "ns/op", int precision = 3) {
+	std::cout << std::setw(48) << std::left << name << std::fixed << std::setprecision(precision) << value << " " << unit << std::endl;
+}
+
+//obf_bench_sink: preventing results from being optimized out
+static volatile uint64_t obf_bench_sink;
+
+/* ************** LITERAL DECODE LATENCY **************** */
+//each iteration decodes a literal as 'y - zero()' within a dependency chain, so we're measuring latency, not throughput 
+static volatile uint32_t obf_bench_volatile_zero = 0;
+
+ITHARE_OBF_NOINLINE void bench_literal_plain(size_t n) {
+	uint32_t x = 0;
+	for (size_t i = 0; i < n; ++i)
+		x = (x ^ UINT32_C(0x1234'5678)) * 3;
+	obf_bench_sink = x;
+}
+ITHARE_OBF_NOINLINE void bench_literal_volatile(size_t n) {
+	uint32_t x = 0;
+	for (size_t i = 0; i < n; ++i)
+		x = (x ^ (UINT32_C(0x1234'5678) - obf_bench_volatile_zero)) * 3;
+	obf_bench_sink = x;
+}
+#ifdef ITHARE_OBF_SEED
+ITHARE_OBF_NOINLINE void bench_literal_aliased(size_t n) {
+	uint32_t x = 0;
+	for (size_t i = 0; i < n; ++i) {
+		uint32_t a, b;
+		x = (x ^ (UINT32_C(0x1234'5678) - ithare::kscope::obf_aliased_zero(&a, &b))) * 3;
+	}
+	obf_bench_sink = x;
+}
+#endif
+ITHARE_OBF_NOINLINE void bench_literal_opaque(size_t n) {
+	uint32_t x = 0;
+	for (size_t i = 0; i < n; ++i)
+		x = (x ^ (UINT32_C(0x1234'5678) - ithare::obf::obf_opaque_zero<uint32_t>())) * 3;
+	obf_bench_sink = x;
+}
+
+static void bench_literals() {
+	std::cout << "--- literal decode latency ---" << std::endl;
+	obf_bench_report("plain", obf_bench_ns_per_op(bench_literal_plain));
+	obf_bench_report("volatile zero", obf_bench_ns_per_op(bench_literal_volatile));
+#ifdef ITHARE_OBF_SEED
+	obf_bench_report("aliased pointers (literal last+1)", obf_bench_ns_per_op(bench_literal_aliased));
+#endif
+	obf_bench_report("obf_opaque() (literal last+5)", obf_bench_ns_per_op(bench_literal_opaque));
+}
+
+/* ************** ENTITY ARRAY (sizeof(OBF) vs sizeof(T)) **************** */
+#define NENTITIES 1'000'000
+
+struct PlainEntity {
+	uint32_t hp;
+	uint32_t x;
+	uint32_t y;
+	uint32_t z;
+};
+struct ObfEntity {
+	OBFI3(uint32_t) hp;
+	OBFI3(uint32_t) x;
+	OBFI3(uint32_t) y;
+	OBFI3(uint32_t) z;
+};
+
+template<class Entity>
+ITHARE_OBF_NOINLINE void bench_entities_update(Entity* entities, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		Entity& e = entities[i%NENTITIES];
+		e.x += 1;
+		if(e.hp > 0)
+			e.hp -= 1;
+	}
+}
+
+template<class Entity>
+static void bench_entities_one(const char* name) {
+	Entity* entities = new Entity[NENTITIES];
+	for (size_t i = 0; i < NENTITIES; ++i) {
+		entities[i].hp = uint32_t(i);
+		entities[i].x = entities[i].y = entities[i].z = 0;
+	}
+	std::cout << "  " << name << ": sizeof(entity)=" << sizeof(Entity) << " array=" << sizeof(Entity)*NENTITIES/1024 << "K" << std::endl;
+	obf_bench_report(name, obf_bench_ns_per_op([entities](size_t n) { bench_entities_update(entities, n); }));
+	obf_bench_sink = entities[NENTITIES/2].hp;
+	delete [] entities;
+}
+
+static void bench_entities() {
+	std::cout << "--- 1M-entity array update ---" << std::endl;
+	using Report = ithare::obf::ObfSizeofReport<OBFI3(uint32_t)>;
+	std::cout << "  sizeof(OBFI3(uint32_t))=" << Report::obf_size << " sizeof(uint32_t)=" << Report::plain_size << (Report::is_compact ? "" : " NOT COMPACT (see ITHARE_OBF_COMPACT)") << std::endl;
+	bench_entities_one<PlainEntity>("plain entities");
+	bench_entities_one<ObfEntity>("OBFI3() entities");
+}
+
+/* ************** COLD LITERALS **************** */
+//the same as factorial() in obftest.cpp, with literal decoded inline vs outlined 
+ITHARE_OBF_NOINLINE uint64_t bench_cold_literal_inline(int64_t x) {
+	if (x < 0)
+		throw std::runtime_error(OBFS5L("Negative argument to factorial!"));
+	uint64_t ret = 1;
+	for (int64_t i = 1; i <= x; ++i)
+		ret *= uint64_t(i);
+	return ret;
+}
+ITHARE_OBF_NOINLINE uint64_t bench_cold_literal_outlined(int64_t x) {
+	if (x < 0)
+		throw std::runtime_error(OBFS5L_COLD("Negative argument to factorial!"));
+	uint64_t ret = 1;
+	for (int64_t i = 1; i <= x; ++i)
+		ret *= uint64_t(i);
+	return ret;
+}
+
+static void bench_cold_literals() {
+	std::cout << "--- cold literals (code size: see nm output from nix/obfbench.sh) ---" << std::endl;
+	obf_bench_report("OBFS5L() in throw branch", obf_bench_ns_per_op([](size_t n) { 
+		uint64_t sum = 0; 
+		for (size_t i = 0; i < n; ++i)
+			sum += bench_cold_literal_inline(int64_t(i&15));
+		obf_bench_sink = sum;
+	}));
+	obf_bench_report("OBFS5L_COLD() in throw branch", obf_bench_ns_per_op([](size_t n) { 
+		uint64_t sum = 0; 
+		for (size_t i = 0; i < n; ++i)
+			sum += bench_cold_literal_outlined(int64_t(i&15));
+		obf_bench_sink = sum;
+	}));
+}
+
+/* ************** LOGGING **************** */
+ITHARE_OBF_NOINLINE void bench_log_binary(const OBFI3(uint32_t)* values, size_t n) {
+	for (size_t i = 0; i < n; ++i)
+		OBFLOG("player {}: gold={}", values[i&1023], values[(i+1)&1023]);
+}
+ITHARE_OBF_NOINLINE void bench_log_printf(const OBFI3(uint32_t)* values, size_t n) {
+	char buf[64];
+	size_t total = 0;
+	for (size_t i = 0; i < n; ++i)
+		total += snprintf(buf, sizeof(buf), "player %u: gold=%u\n", uint32_t(values[i&1023]), uint32_t(values[(i+1)&1023]));
+	obf_bench_sink = total;
+}
+
+static void bench_log() {
+	std::cout << "--- logging ---" << std::endl;
+	OBFI3(uint32_t)* values = new OBFI3(uint32_t)[1024];
+	for (size_t i = 0; i < 1024; ++i)
+		values[i] = uint32_t(i*100);
+	ITOBF obf_log_set_sink(nullptr);//measuring in-process cost only; buffers are discarded when full
+	obf_bench_report("OBFLOG() (encoded words to per-thread buffer)", obf_bench_ns_per_op([values](size_t n) { bench_log_binary(values, n); }));
+	obf_bench_report("snprintf() of decoded values", obf_bench_ns_per_op([values](size_t n) { bench_log_printf(values, n); }));
+	delete [] values;
+}
+
+/* ************** DUMP DECODING **************** */
+#define NDUMPVALUES (16*1024*1024)
+
+static void bench_dump_decode() {
+	std::cout << "--- bulk dump decoding ---" << std::endl;
+	using DumpT = ITOBF ObfDumpType<OBFI3(uint32_t)>;
+	uint8_t* dump = new uint8_t[NDUMPVALUES * sizeof(OBFI3(uint32_t))];
+	for (size_t i = 0; i < NDUMPVALUES; ++i)
+		DumpT::encode(i, dump + i * sizeof(OBFI3(uint32_t)));
+	uint64_t* out = new uint64_t[ITOBF obf_dump_chunk];
+	double ns = obf_bench_ns_per_op([dump,out](size_t n) {
+		for (size_t i = 0; i < n; i += ITOBF obf_dump_chunk)
+			DumpT::decode(dump + (i % NDUMPVALUES) * sizeof(OBFI3(uint32_t)), ITOBF obf_dump_chunk, out);
+		obf_bench_sink = out[17];
+	}, NDUMPVALUES);
+	obf_bench_report("ObfDumpType<OBFI3(uint32_t)>::decode()", ns);
+	obf_bench_report("ObfDumpType<OBFI3(uint32_t)>::decode(), dump", sizeof(OBFI3(uint32_t)) / ns, "GB/s", 2);
+	delete [] out;
+	delete [] dump;
+}
+
+/* ************** PERSISTENCE **************** */
+#define NPERSIST 1'000'000
+
+static void bench_persist() {
+	std::cout << "--- save/load of 1M OBFI3(uint32_t) fields ---" << std::endl;
+	OBFI3(uint32_t)* values = new OBFI3(uint32_t)[NPERSIST];
+	for (size_t i = 0; i < NPERSIST; ++i)
+		values[i] = uint32_t(i);
+	uint8_t* stored = new uint8_t[NPERSIST * ITOBF obf_persist_size<OBFI3(uint32_t)>()];
+	uint32_t* plain = new uint32_t[NPERSIST];
+
+	obf_bench_report("obf_persist_save() per field", obf_bench_ns_per_op([values,stored](size_t n) {
+		for (size_t i = 0; i < n; i += NPERSIST)
+			ITOBF obf_persist_save(values, NPERSIST, stored);
+	}, 10*NPERSIST));
+	obf_bench_report("obf_persist_load() per field", obf_bench_ns_per_op([values,stored](size_t n) {
+		for (size_t i = 0; i < n; i += NPERSIST)
+			ITOBF obf_persist_load(stored, NPERSIST, values);
+	}, 10*NPERSIST));
+	for (size_t i = 0; i < NPERSIST; ++i) {
+		if (uint32_t(values[i]) != uint32_t(i))
+			throw std::runtime_error("bench_persist: obf_persist_load() mismatch");
+	}
+	obf_bench_report("naive save (surject+memcpy) per field", obf_bench_ns_per_op([values,stored,plain](size_t n) {
+		for (size_t i = 0; i < n; i += NPERSIST) {
+			for (size_t j = 0; j < NPERSIST; ++j)
+				plain[j] = uint32_t(values[j]);
+			memcpy(stored, plain, NPERSIST * sizeof(uint32_t));
+		}
+	}, 10*NPERSIST));
+	obf_bench_report("naive load (memcpy+inject) per field", obf_bench_ns_per_op([values,stored,plain](size_t n) {
+		for (size_t i = 0; i < n; i += NPERSIST) {
+			memcpy(plain, stored, NPERSIST * sizeof(uint32_t));
+			for (size_t j = 0; j < NPERSIST; ++j)
+				values[j] = plain[j];
+		}
+	}, 10*NPERSIST));
+	for (size_t i = 0; i < NPERSIST; ++i) {
+		if (uint32_t(values[i]) != uint32_t(i))
+			throw std::runtime_error("bench_persist: naive save/load mismatch");
+	}
+	delete [] plain;
+	delete [] stored;
+	delete [] values;
+}
+
+/* ************** SNAPSHOT DELTAS **************** */
+#define NWORLDENTITIES 100'000
+
+static void bench_delta() {
+	std::cout << "--- snapshot deltas, 100K-entity world, 1% entities changed per tick ---" << std::endl;
+	ObfEntity* world = new ObfEntity[NWORLDENTITIES];
+	for (size_t i = 0; i < NWORLDENTITIES; ++i) {
+		world[i].hp = uint32_t(i);
+		world[i].x = world[i].y = world[i].z = 0;
+	}
+	std::vector<uint8_t> prev = ITOBF obf_snapshot(world, NWORLDENTITIES);
+	for (size_t i = 0; i < NWORLDENTITIES; i += 100)
+		world[i].x += 1;
+	std::vector<uint8_t> cur;
+	std::vector<uint8_t> delta;
+	constexpr size_t world_size = sizeof(ObfEntity) * NWORLDENTITIES;
+	auto mbps = [](double ns_per_byte) { return 1000. / ns_per_byte; };
+
+	double ns = obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += world_size)
+			cur = ITOBF obf_snapshot(world, NWORLDENTITIES);
+	}, 100*world_size);
+	obf_bench_report("obf_snapshot()", mbps(ns), "MB/s", 0);
+	ns = obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += world_size) {
+			delta.clear();
+			ITOBF obf_delta_encode(prev.data(), cur.data(), world_size, delta);
+		}
+	}, 100*world_size);
+	obf_bench_report("obf_delta_encode()", mbps(ns), "MB/s", 0);
+	std::cout << "  delta=" << delta.size() << " bytes out of " << world_size << std::endl;
+	std::vector<uint8_t> applied = prev;
+	if (!ITOBF obf_delta_apply(applied.data(), world_size, delta.data(), delta.size()) || applied != cur)
+		throw std::runtime_error("bench_delta: applying delta to previous snapshot doesn't give current one");
+	ns = obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += world_size)
+			ITOBF obf_delta_apply(applied.data(), world_size, delta.data(), delta.size());//NB: XOR - applying twice goes back to prev  
+	}, 100*world_size);
+	obf_bench_report("obf_delta_apply()", mbps(ns), "MB/s", 0);
+	delete [] world;
+}
+
+/* ************** CONFIG LOADING **************** */
+//~50MB JSON array of unit configs; obf_config_load_array() vs two-pass 'parse into strings, then assign'
+struct ConfigUnit {
+	OBFI3(uint32_t) speed_cap;
+	OBFI3(int32_t) cooldown;
+	OBFI3(uint32_t) damage;
+};
+
+static const ITOBF ObfConfigField<ConfigUnit> config_unit_fields[] = {
+	ITHARE_OBF_CONFIG_FIELD(ConfigUnit,speed_cap),
+	ITHARE_OBF_CONFIG_FIELD(ConfigUnit,cooldown),
+	ITHARE_OBF_CONFIG_FIELD_NAMED(ConfigUnit,damage,"weapon.damage"),
+};
+
+ITHARE_OBF_NOINLINE void bench_config_two_pass(const std::string& json, std::vector<ConfigUnit>& out) {
+	//pass 1: generic parse into key/value strings (a la DOM-based loaders)
+	std::vector<std::vector<std::pair<std::string,std::string>>> dom;
+	std::string path;
+	std::vector<size_t> path_stack;
+	size_t i = 0;
+	auto skip_ws = [&]() { while (i < json.size() && isspace((unsigned char)json[i])) ++i; };
+	auto read_string = [&]() { ++i; size_t b = i; while (json[i] != '"') ++i; return json.substr(b, (i++) - b); };
+	while (i < json.size()) {
+		skip_ws();
+		if (i >= json.size())
+			break;
+		char c = json[i];
+		if (c == '{') {
+			if (path_stack.empty())
+				dom.emplace_back();
+			path_stack.push_back(path.size());
+			++i;
+		}
+		else if (c == '}') {
+			path.resize(path_stack.back());
+			path_stack.pop_back();
+			if (!path_stack.empty()) {
+				size_t dot = path.rfind('.');
+				path.resize(dot == std::string::npos ? 0 : dot);
+			}
+			++i;
+		}
+		else if (c == '"') {
+			std::string key = read_string();
+			skip_ws();
+			++i;//':'
+			skip_ws();
+			std::string full = path.empty() ? key : path + "." + key;
+			if (json[i] == '{') {
+				path = full;
+				continue;
+			}
+			size_t b = i;
+			if (json[i] == '"')
+				read_string();
+			else
+				while (json[i] != ',' && json[i] != '}' && !isspace((unsigned char)json[i])) ++i;
+			dom.back().emplace_back(full, json.substr(b, i - b));
+		}
+		else
+			++i;//'[', ']', ','
+	}
+	//pass 2: assigning
+	out.resize(dom.size());
+	for (size_t u = 0; u < dom.size(); ++u) {
+		for (auto& kv : dom[u]) {
+			if (kv.first == "speed_cap")
+				out[u].speed_cap = uint32_t(std::stoul(kv.second));
+			else if (kv.first == "cooldown")
+				out[u].cooldown = int32_t(std::stol(kv.second));
+			else if (kv.first == "weapon.damage")
+				out[u].damage = uint32_t(std::stoul(kv.second));
+		}
+	}
+}
+
+static void bench_config() {
+	std::cout << "--- config loading, ~50MB JSON ---" << std::endl;
+	std::string json = "[\n";
+	for (uint32_t i = 0; json.size() < 50'000'000; ++i) {
+		if (i)
+			json += ",\n";
+		json += "{\"name\": \"unit" + std::to_string(i) + "\", \"speed_cap\": " + std::to_string(i % 1000) 
+			+ ", \"cooldown\": " + std::to_string(int32_t(i % 77) - 38) + ", \"weapon\": {\"damage\": " + std::to_string(i * 7) 
+			+ ", \"tags\": [\"melee\", \"fire\"]}}";
+	}
+	json += "\n]\n";
+	double mb = double(json.size()) / 1e6;
+	auto secs = [](auto started) { return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - started).count(); };
+
+	std::vector<ConfigUnit> units;
+	auto started = std::chrono::high_resolution_clock::now();
+	bench_config_two_pass(json, units);
+	double t = secs(started);
+	std::cout << "  " << units.size() << " units" << std::endl;
+	obf_bench_report("two-pass (parse-then-assign)", mb / t, "MB/s", 0);
+	size_t nunits = units.size();
+	auto check = [nunits](const std::vector<ConfigUnit>& us, const char* what) {
+		bool ok = us.size() == nunits;
+		for (uint32_t i = 0; ok && i < us.size(); ++i)
+			ok = uint32_t(us[i].speed_cap) == i % 1000 && int32_t(us[i].cooldown) == int32_t(i % 77) - 38 && uint32_t(us[i].damage) == i * 7;
+		if (!ok)
+			throw std::runtime_error(std::string("bench_config: wrong units loaded by ") + what);
+	};
+	check(units, "two-pass loader");
+
+	units.clear();
+	started = std::chrono::high_resolution_clock::now();
+	bool ok = ITOBF obf_config_load_array(json.c_str(), json.size(), units, config_unit_fields);
+	t = secs(started);
+	if (!ok)
+		throw std::runtime_error("bench_config: obf_config_load_array() failed");
+	check(units, "obf_config_load_array()");
+	obf_bench_report("obf_config_load_array()", mb / t, "MB/s", 0);
+
+	units.clear();
+	started = std::chrono::high_resolution_clock::now();
+	ok = ITOBF obf_config_load_array(&json[0], json.size(), units, config_unit_fields);
+	t = secs(started);
+	if (!ok || json.find("\"speed_cap\": 1") != std::string::npos)
+		throw std::runtime_error("bench_config: numbers were not wiped");
+	check(units, "obf_config_load_array() with wiping");
+	obf_bench_report("obf_config_load_array() with wiping", mb / t, "MB/s", 0);
+	obf_bench_sink = units.size();
+}
+
+/* ************** CONSTANT-TIME COMPARISONS **************** */
+#define NCTELEMS 4096
+
+static void bench_ct_compare() {
+	std::cout << "--- constant-time comparisons, 4096 x uint32_t, equal arrays ---" << std::endl;
+	uint32_t* pa = new uint32_t[NCTELEMS];
+	uint32_t* pb = new uint32_t[NCTELEMS];
+	OBFI3(uint32_t)* oa = new OBFI3(uint32_t)[NCTELEMS];
+	OBFI3(uint32_t)* ob = new OBFI3(uint32_t)[NCTELEMS];
+	OBFI4(uint32_t)* ob4 = new OBFI4(uint32_t)[NCTELEMS];
+	for (size_t i = 0; i < NCTELEMS; ++i) {
+		pa[i] = pb[i] = uint32_t(i * 2654435761u);
+		oa[i] = ob[i] = ob4[i] = pa[i];
+	}
+	size_t nops = NBENCH / 100;
+	auto report = [](const char* name, double ns) {
+		obf_bench_report(name, ns / NCTELEMS, "ns/element");
+	};
+	report("memcmp(), plain", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + (memcmp(pa, pb, NCTELEMS * sizeof(uint32_t)) == 0);
+	}, nops));
+	report("obf_ct_equal(), plain", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_ct_equal(pa, pb, NCTELEMS);
+	}, nops));
+	report("obf_ct_equal(), shared encoding", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_ct_equal(oa, ob, NCTELEMS);
+	}, nops));
+	report("obf_ct_equal(), lane-wise transcoding", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_ct_equal(oa, ob4, NCTELEMS);
+	}, nops));
+	report("obf_ct_compare(), obfuscated", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_ct_compare(oa, ob4, NCTELEMS);
+	}, nops));
+
+	//timing MUST NOT depend on position of the first difference; early-exit comparison would show ratio of ~1/NCTELEMS
+	//  wall-clock ratios are too noisy for obftest, so they're only reported here
+	//  (-DITHARE_OBF_BENCH_CHECK_CT_TIMING turns an out-of-range ratio into a failure)
+	auto min_time = [&](const OBFI3(uint32_t)* b) {
+		double best = 1e30;
+		for (int k = 0; k < 51; ++k)//min over runs to filter out scheduling noise
+			best = std::min(best, obf_bench_ns_per_op([&](size_t n) {
+				for (size_t i = 0; i < n; ++i)
+					obf_bench_sink = obf_bench_sink + ITOBF obf_ct_equal(oa, b, NCTELEMS);
+			}, 16));
+		return best;
+	};
+	ob[0] = 12345678;
+	double t_early = min_time(ob);
+	ob[0] = oa[0];
+	ob[NCTELEMS-1] = 12345678;
+	double t_late = min_time(ob);
+	obf_bench_report("obf_ct_equal(), first/last differs time ratio", t_early / t_late, "x");
+#ifdef ITHARE_OBF_BENCH_CHECK_CT_TIMING
+	if (t_early / t_late < 0.5 || t_early / t_late > 2.)
+		throw std::runtime_error("bench_ct_compare: obf_ct_equal() timing depends on position of the first difference");
+#endif
+	delete [] ob4;
+	delete [] ob;
+	delete [] oa;
+	delete [] pb;
+	delete [] pa;
+}
+
+/* ************** LIBRARY ALGORITHMS **************** */
+//std:: algorithms vs obf_*_n() kernels, both on plain uint32_t and on OBFI3(uint32_t)
+#define NALGOELEMS 1'000'000
+
+template<class T>
+static void bench_algorithms_for(const char* tname, T* arr) {
+	size_t nops = NBENCH / 1000;
+	auto report = [tname](const char* name, double ns) {
+		obf_bench_report(std::string(name) + ", " + tname, ns / NALGOELEMS, "ns/element");
+	};
+	report("std::fill()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			std::fill(arr, arr + NALGOELEMS, T(uint32_t(i)));
+			obf_bench_sink = obf_bench_sink + uint32_t(arr[i % NALGOELEMS]);
+		}
+	}, nops));
+	report("obf_fill_n()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			ITOBF obf_fill_n(arr, NALGOELEMS, uint32_t(i));
+			obf_bench_sink = obf_bench_sink + uint32_t(arr[i % NALGOELEMS]);
+		}
+	}, nops));
+	for (size_t i = 0; i < NALGOELEMS; ++i)
+		arr[i] = uint32_t(i * 2654435761u) % 1000;
+	report("std::find() (not found)", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + size_t(std::find(arr, arr + NALGOELEMS, uint32_t(5000)) - arr);
+	}, nops));
+	report("obf_find_n() (not found)", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_find_n(arr, NALGOELEMS, uint32_t(5000));
+	}, nops));
+	report("std::count()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + size_t(std::count(arr, arr + NALGOELEMS, uint32_t(i % 1000)));
+	}, nops));
+	report("obf_count_n()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_count_n(arr, NALGOELEMS, uint32_t(i % 1000));
+	}, nops));
+	report("std::accumulate()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + std::accumulate(arr, arr + NALGOELEMS, uint64_t(0));
+	}, nops));
+	report("obf_accumulate_n()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_accumulate_n(arr, NALGOELEMS, uint64_t(0));
+	}, nops));
+	report("std::minmax_element()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			auto mm = std::minmax_element(arr, arr + NALGOELEMS);
+			obf_bench_sink = obf_bench_sink + uint32_t(*mm.first) + uint32_t(*mm.second);
+		}
+	}, nops));
+	report("obf_minmax_n()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			auto mm = ITOBF obf_minmax_n(arr, NALGOELEMS);
+			obf_bench_sink = obf_bench_sink + mm.first + mm.second;
+		}
+	}, nops));
+	report("std::reverse()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			std::reverse(arr, arr + NALGOELEMS);
+	}, nops));
+	report("obf_reverse_n()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			ITOBF obf_reverse_n(arr, NALGOELEMS);
+	}, nops));
+}
+
+static void bench_algorithms() {
+	std::cout << "--- library algorithms, 1M elements ---" << std::endl;
+	uint32_t* plain = new uint32_t[NALGOELEMS];
+	bench_algorithms_for("plain", plain);
+	delete [] plain;
+	OBFI3(uint32_t)* obf = new OBFI3(uint32_t)[NALGOELEMS];
+	bench_algorithms_for("OBFI3", obf);
+	delete [] obf;
+}
+
+/* ************** PARALLEL ALGORITHMS **************** */
+//scaling over 1..64 threads, 100M x OBFI3(uint32_t); each result is checked against serial one
+#define NPARELEMS 100'000'000
+
+static void bench_parallel() {
+	std::cout << "--- parallel algorithms, 100M x OBFI3(uint32_t), hardware_concurrency=" << std::thread::hardware_concurrency() << " ---" << std::endl;
+	OBFI3(uint32_t)* arr = new OBFI3(uint32_t)[NPARELEMS];
+	OBFI4(uint32_t)* transcoded = new OBFI4(uint32_t)[NPARELEMS];
+	for (size_t i = 0; i < NPARELEMS; ++i)
+		arr[i] = uint32_t(i * 2654435761u) % 1000;
+	uint64_t serial_sum = ITOBF obf_accumulate_n(arr, NPARELEMS, uint64_t(0));
+	size_t serial_count = ITOBF obf_count_n(arr, NPARELEMS, 777);
+	ITOBF obf_transcode_n(arr, transcoded, NPARELEMS);//also pre-faulting pages of transcoded[]
+	auto secs = [](auto started) { return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - started).count(); };
+	for (size_t nthreads = 1; nthreads <= 64; nthreads *= 2) {
+		ITOBF ObfThreadPool pool(nthreads);
+		auto started = std::chrono::high_resolution_clock::now();
+		uint64_t sum = ITOBF obf_par_accumulate_n(pool, arr, NPARELEMS, uint64_t(0));
+		double t_acc = secs(started);
+		started = std::chrono::high_resolution_clock::now();
+		size_t cnt = ITOBF obf_par_count_n(pool, arr, NPARELEMS, 777);
+		double t_cnt = secs(started);
+		started = std::chrono::high_resolution_clock::now();
+		ITOBF obf_par_transcode_n(pool, arr, transcoded, NPARELEMS);
+		double t_tr = secs(started);
+		if (sum != serial_sum || cnt != serial_count || uint32_t(transcoded[NPARELEMS-1]) != uint32_t(arr[NPARELEMS-1]))
+			throw std::runtime_error("bench_parallel: parallel result differs from serial one");
+		std::string threads = ", " + std::to_string(nthreads) + " thread(s)";
+		obf_bench_report("obf_par_accumulate_n()" + threads, t_acc * 1000., "ms", 1);
+		obf_bench_report("obf_par_count_n()" + threads, t_cnt * 1000., "ms", 1);
+		obf_bench_report("obf_par_transcode_n()" + threads, t_tr * 1000., "ms", 1);
+	}
+	delete [] transcoded;
+	delete [] arr;
+}
+
+/* ************** CHECKSUMS **************** */
+//64MB of OBFI3(uint32_t); checksumming encoded array vs decode-then-checksum
+#define NCHECKSUMELEMS (16*1024*1024)
+
+static void bench_checksum() {
+	std::cout << "--- checksums, 64MB of OBFI3(uint32_t) ---" << std::endl;
+	OBFI3(uint32_t)* arr = new OBFI3(uint32_t)[NCHECKSUMELEMS];
+	uint32_t* plain = new uint32_t[NCHECKSUMELEMS];
+	for (size_t i = 0; i < NCHECKSUMELEMS; ++i)
+		arr[i] = plain[i] = uint32_t(i * 2654435761u);
+	constexpr size_t nbytes = NCHECKSUMELEMS * sizeof(uint32_t);
+	auto report = [](const char* name, double ns_per_byte) {
+		obf_bench_report(name, 1. / ns_per_byte, "GB/s", 2);
+	};
+	uint32_t expected_crc = ITOBF obf_crc32c_bytes(plain, nbytes);
+	uint32_t expected_xxh = ITOBF obf_xxh32_bytes(plain, nbytes);
+	if (ITOBF obf_crc32c(arr, NCHECKSUMELEMS) != expected_crc || ITOBF obf_xxh32(arr, NCHECKSUMELEMS) != expected_xxh)
+		throw std::runtime_error("bench_checksum: checksum of encoded data differs from plaintext one");
+	report("obf_crc32c_bytes(), plain", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += nbytes)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_crc32c_bytes(plain, nbytes);
+	}, 16 * nbytes));
+	report("decode-then-obf_crc32c_bytes()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += nbytes) {
+			ITOBF obf_transcode_n(arr, plain, NCHECKSUMELEMS);
+			obf_bench_sink = obf_bench_sink + ITOBF obf_crc32c_bytes(plain, nbytes);
+		}
+	}, 16 * nbytes));
+	report("obf_crc32c(), encoded", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += nbytes)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_crc32c(arr, NCHECKSUMELEMS);
+	}, 16 * nbytes));
+	report("obf_xxh32_bytes(), plain", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += nbytes)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_xxh32_bytes(plain, nbytes);
+	}, 16 * nbytes));
+	report("decode-then-obf_xxh32_bytes()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += nbytes) {
+			ITOBF obf_transcode_n(arr, plain, NCHECKSUMELEMS);
+			obf_bench_sink = obf_bench_sink + ITOBF obf_xxh32_bytes(plain, nbytes);
+		}
+	}, 16 * nbytes));
+	report("obf_xxh32(), encoded", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += nbytes)
+			obf_bench_sink = obf_bench_sink + ITOBF obf_xxh32(arr, NCHECKSUMELEMS);
+	}, 16 * nbytes));
+	delete [] plain;
+	delete [] arr;
+}
+
+/* ************** RNG **************** */
+//plain xoshiro256** vs xoshiro256** with OBFI3(uint64_t) state used 'as is' vs ObfRng<>
+struct PlainXoshiro {
+	uint64_t s[4];
+	static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+	uint64_t operator()() {
+		uint64_t ret = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return ret;
+	}
+};
+struct NaiveObfXoshiro {
+	OBFI3(uint64_t) s[4];
+	uint64_t operator()() {
+		OBFI3(uint64_t) r = s[1] * 5;
+		r = (r << 7) | (r >> 57);
+		r *= 9;
+		OBFI3(uint64_t) t = s[1] << 17;
+		s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = (s[3] << 45) | (s[3] >> 19);
+		return r;
+	}
+};
+
+static void bench_rng() {
+	std::cout << "--- RNG, xoshiro256** ---" << std::endl;
+	auto report = [](const char* name, double ns) {
+		obf_bench_report(name, 1000. / ns, "M numbers/s", 1);
+	};
+	PlainXoshiro plain;
+	NaiveObfXoshiro naive;
+	for (int i = 0; i < 4; ++i)
+		plain.s[i] = naive.s[i] = ITOBF obf_splitmix64(uint64_t(i) * UINT64_C(0x9e37'79b9'7f4a'7c15));
+	ITOBF ObfRng<OBFI3(uint64_t)> rng(0);
+	report("plain xoshiro256**", obf_bench_ns_per_op([&](size_t n) {
+		uint64_t x = 0;
+		for (size_t i = 0; i < n; ++i)
+			x += plain();
+		obf_bench_sink = x;
+	}));
+	report("naive OBFI3(uint64_t) xoshiro256**", obf_bench_ns_per_op([&](size_t n) {
+		uint64_t x = 0;
+		for (size_t i = 0; i < n; ++i)
+			x += naive();
+		obf_bench_sink = x;
+	}));
+	report("ObfRng<>::operator()", obf_bench_ns_per_op([&](size_t n) {
+		uint64_t x = 0;
+		for (size_t i = 0; i < n; ++i)
+			x += rng();
+		obf_bench_sink = x;
+	}));
+	uint64_t batch[1024];
+	report("ObfRng<>::generate(), 1024/batch", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += 1024) {
+			rng.generate(batch, 1024);
+			obf_bench_sink = obf_bench_sink + batch[i % 1024];
+		}
+	}));
+}
+
+/* ************** ARENA **************** */
+//1M ObfEntity-s per 'frame': allocation, then iteration in allocation order, then freeing everything
+#define NARENAOBJECTS 1'000'000
+
+class PlainBumpArena {
+	uint8_t* mem;
+	size_t size;
+	size_t used = 0;
+	public:
+	PlainBumpArena(size_t size_) : mem(new uint8_t[size_]), size(size_) {}
+	~PlainBumpArena() { delete [] mem; }
+	void* allocate(size_t sz, size_t align) {
+		used = (used + align - 1) & ~(align - 1);
+		if (used + sz > size)
+			throw std::bad_alloc();
+		void* ret = mem + used;
+		used += sz;
+		return ret;
+	}
+	void reset() { used = 0; }
+};
+
+template<class Alloc, class Free>
+static void bench_arena_for(const char* name, std::vector<ObfEntity*>& ptrs, Alloc alloc, Free free_all) {
+	double ns_alloc = 0, ns_iter = 0, ns_free = 0;
+	constexpr int nframes = 10;
+	for (int frame = 0; frame < nframes + 1; ++frame) {//frame 0 is warm-up
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < NARENAOBJECTS; ++i)
+			ptrs[i] = alloc(i);
+		auto t1 = std::chrono::high_resolution_clock::now();
+		uint64_t sum = 0;
+		for (size_t i = 0; i < NARENAOBJECTS; ++i)
+			sum += uint32_t(ptrs[i]->hp);
+		obf_bench_sink = sum;
+		auto t2 = std::chrono::high_resolution_clock::now();
+		free_all();
+		auto t3 = std::chrono::high_resolution_clock::now();
+		if (frame) {
+			ns_alloc += std::chrono::duration<double, std::nano>(t1 - t0).count();
+			ns_iter += std::chrono::duration<double, std::nano>(t2 - t1).count();
+			ns_free += std::chrono::duration<double, std::nano>(t3 - t2).count();
+		}
+	}
+	double n = double(nframes) * NARENAOBJECTS;
+	obf_bench_report(std::string(name) + ", alloc", ns_alloc / n, "ns/object", 2);
+	obf_bench_report(std::string(name) + ", iterate", ns_iter / n, "ns/object", 2);
+	obf_bench_report(std::string(name) + ", free", ns_free / n, "ns/object", 2);
+}
+
+static void bench_arena() {
+	std::cout << "--- arena, 1M x ObfEntity per frame ---" << std::endl;
+	std::vector<ObfEntity*> ptrs(NARENAOBJECTS);
+	bench_arena_for("new/delete", ptrs, [](size_t i) { 
+		ObfEntity* e = new ObfEntity; 
+		e->hp = uint32_t(i);
+		return e; 
+	}, [&]() { 
+		for (auto p : ptrs) 
+			delete p; 
+	});
+	PlainBumpArena bump(NARENAOBJECTS * sizeof(ObfEntity));
+	bench_arena_for("plain bump arena", ptrs, [&](size_t i) { 
+		ObfEntity* e = new(bump.allocate(sizeof(ObfEntity), alignof(ObfEntity))) ObfEntity; 
+		e->hp = uint32_t(i);
+		return e; 
+	}, [&]() { bump.reset(); });
+	ITOBF ObfArena arena;
+	bench_arena_for("ObfArena", ptrs, [&](size_t i) { 
+		ObfEntity* e = arena.create<ObfEntity>(); 
+		e->hp = uint32_t(i);
+		return e; 
+	}, [&]() { arena.reset(); });
+	ITOBF ObfArena arena_rnd(ITOBF ObfArena::default_chunk_size, ITOBF ObfArena::default_stripe_size, 0x1234'5678);
+	bench_arena_for("ObfArena, randomized", ptrs, [&](size_t i) { 
+		ObfEntity* e = arena_rnd.create<ObfEntity>(); 
+		e->hp = uint32_t(i);
+		return e; 
+	}, [&]() { arena_rnd.reset(); });
+}
+
+/* ************** STRUCT LAYOUT **************** */
+//entity-update loop (x += vx; y += vy) over 1M entities: source-order layout with hot fields scattered vs ObfStruct<>
+#define NLAYOUTENTITIES 1'000'000
+
+struct SourceOrderEntity {
+	OBFI3(int32_t) x;
+	char name[48];
+	OBFI3(int32_t) y;
+	char inventory[64];
+	OBFI3(int32_t) vx;
+	OBFI3(uint64_t) gold;
+	OBFI3(int32_t) vy;
+	OBFI3(uint32_t) flags;
+};
+
+using PlannedEntity = ITHARE_OBF_STRUCT(PlannedEntity,
+	ITOBF ObfField<struct entity_x, OBFI3(int32_t), true>,
+	ITOBF ObfField<struct entity_name, char[48]>,
+	ITOBF ObfField<struct entity_y, OBFI3(int32_t), true>,
+	ITOBF ObfField<struct entity_inventory, char[64]>,
+	ITOBF ObfField<struct entity_vx, OBFI3(int32_t), true>,
+	ITOBF ObfField<struct entity_gold, OBFI3(uint64_t)>,
+	ITOBF ObfField<struct entity_vy, OBFI3(int32_t), true>,
+	ITOBF ObfField<struct entity_flags, OBFI3(uint32_t)>);
+
+ITHARE_OBF_NOINLINE void bench_layout_update(SourceOrderEntity* e, size_t n) {
+	for (size_t j = 0; j < n; ++j) {
+		e[j].x += e[j].vx;
+		e[j].y += e[j].vy;
+	}
+}
+ITHARE_OBF_NOINLINE void bench_layout_update(PlannedEntity* e, size_t n) {
+	for (size_t j = 0; j < n; ++j) {
+		e[j].get<entity_x>() += e[j].get<entity_vx>();
+		e[j].get<entity_y>() += e[j].get<entity_vy>();
+	}
+}
+
+static size_t bench_layout_lines_touched(std::initializer_list<size_t> offsets, size_t field_size) {//for cache-line-aligned object
+	size_t lo = SIZE_MAX, hi = 0;
+	for (size_t o : offsets) {
+		lo = std::min(lo, o / ITOBF obf_cache_line);
+		hi = std::max(hi, (o + field_size - 1) / ITOBF obf_cache_line);
+	}
+	return hi - lo + 1;
+}
+
+static void bench_layout() {
+	std::cout << "--- struct layout, entity-update loop over 1M entities ---" << std::endl;
+	SourceOrderEntity* src = new SourceOrderEntity[NLAYOUTENTITIES];
+	PlannedEntity* planned = new PlannedEntity[NLAYOUTENTITIES];
+	for (size_t i = 0; i < NLAYOUTENTITIES; ++i) {
+		src[i].x = src[i].y = 0;
+		src[i].vx = src[i].vy = int32_t(i % 7) - 3;
+		planned[i].get<entity_vx>() = planned[i].get<entity_vy>() = int32_t(i % 7) - 3;
+	}
+	size_t src_lines = bench_layout_lines_touched({offsetof(SourceOrderEntity, x), offsetof(SourceOrderEntity, y), 
+		offsetof(SourceOrderEntity, vx), offsetof(SourceOrderEntity, vy)}, sizeof(OBFI3(int32_t)));
+	size_t planned_lines = bench_layout_lines_touched({PlannedEntity::offset_of<entity_x>(), PlannedEntity::offset_of<entity_y>(), 
+		PlannedEntity::offset_of<entity_vx>(), PlannedEntity::offset_of<entity_vy>()}, sizeof(OBFI3(int32_t)));
+	double ns = obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += NLAYOUTENTITIES)
+			bench_layout_update(src, NLAYOUTENTITIES);
+	}, 20 * NLAYOUTENTITIES);
+	obf_bench_sink = uint32_t(src[NLAYOUTENTITIES-1].x);
+	std::cout << "  source order: sizeof=" << sizeof(SourceOrderEntity) << ", hot cache lines=" << src_lines << std::endl;
+	obf_bench_report("source order", ns, "ns/entity");
+	ns = obf_bench_ns_per_op([&](size_t n) {
+		for (size_t i = 0; i < n; i += NLAYOUTENTITIES)
+			bench_layout_update(planned, NLAYOUTENTITIES);
+	}, 20 * NLAYOUTENTITIES);
+	obf_bench_sink = uint32_t(planned[NLAYOUTENTITIES-1].get<entity_x>());
+	std::cout << "  ObfStruct<>: sizeof=" << sizeof(PlannedEntity) << ", hot cache lines=" << planned_lines << std::endl;
+	obf_bench_report("ObfStruct<>", ns, "ns/entity");
+	delete [] planned;
+	delete [] src;
+}
+
+/* ************** MULTIPLICATION **************** */
+//ObfMulInt<>: multiplicative caps vs. OBFI3(); factorial() is the same as in obftest.cpp
+ITHARE_OBF_NOINLINE uint64_t bench_mul_factorial_obf(OBFI3(uint64_t) x) {
+	OBFI3(uint64_t) ret = 1;
+	for (OBFI3(uint64_t) i = 1; i <= x; ++i)
+		ret *= i;
+	return ret;
+}
+ITHARE_OBF_NOINLINE uint64_t bench_mul_factorial_mul(uint64_t x) {
+	ITHARE_OBF_MUL_INT(uint64_t,bench_mul_factorial) ret = 1;
+	for (uint64_t i = 1; i <= x; ++i)
+		ret *= i;
+	return ret.value();
+}
+ITHARE_OBF_NOINLINE uint64_t bench_mul_factorial_plain(uint64_t x) {
+	uint64_t ret = 1;
+	for (uint64_t i = 1; i <= x; ++i)
+		ret *= i;
+	return ret;
+}
+
+static volatile uint64_t bench_mul_n = 20;//volatile to prevent constant-folding of factorial(20)
+constexpr size_t NMULDOT = 4096;
+using BenchMulInt = ITHARE_OBF_MUL_INT(uint32_t,BenchMulInt);
+
+static void bench_mul() {
+	std::cout << "--- multiplicative encoding ---" << std::endl;
+	obf_bench_report("plain factorial(20)", obf_bench_ns_per_op([](size_t n) {
+		uint64_t sum = 0;
+		for (size_t i = 0; i < n; ++i)
+			sum += bench_mul_factorial_plain(bench_mul_n);
+		obf_bench_sink = sum;
+	}));
+	obf_bench_report("OBFI3(uint64_t) factorial(20)", obf_bench_ns_per_op([](size_t n) {
+		uint64_t sum = 0;
+		for (size_t i = 0; i < n; ++i)
+			sum += bench_mul_factorial_obf(bench_mul_n);
+		obf_bench_sink = sum;
+	}));
+	obf_bench_report("ObfMulInt<uint64_t> factorial(20)", obf_bench_ns_per_op([](size_t n) {
+		uint64_t sum = 0;
+		for (size_t i = 0; i < n; ++i)
+			sum += bench_mul_factorial_mul(bench_mul_n);
+		obf_bench_sink = sum;
+	}));
+
+	std::vector<uint32_t> a(NMULDOT), b(NMULDOT);
+	std::vector<OBFI3(uint32_t)> obfa(NMULDOT);
+	std::vector<BenchMulInt> mula(NMULDOT), mulb(NMULDOT);
+	for (size_t i = 0; i < NMULDOT; ++i) {
+		a[i] = uint32_t(i * 7 + 1);
+		b[i] = uint32_t(i * 13 + 5);
+		obfa[i] = a[i];
+		mula[i] = a[i];
+		mulb[i] = b[i];
+	}
+	auto report = [](const char* name, double ns) {
+		obf_bench_report(name, ns, "ns/element");
+	};
+	report("plain dot product", obf_bench_ns_per_op([&](size_t n) {
+		uint32_t acc = 0;
+		for (size_t k = 0; k < n; k += NMULDOT)
+			for (size_t i = 0; i < NMULDOT; ++i)
+				acc += a[i] * b[i];
+		obf_bench_sink = acc;
+	}));
+	report("OBFI3(uint32_t) * plain dot product", obf_bench_ns_per_op([&](size_t n) {
+		OBFI3(uint32_t) acc = 0;
+		for (size_t k = 0; k < n; k += NMULDOT)
+			for (size_t i = 0; i < NMULDOT; ++i)
+				acc += obfa[i] * b[i];
+		obf_bench_sink = uint32_t(acc);
+	}));
+	report("ObfMulInt * plain dot product", obf_bench_ns_per_op([&](size_t n) {
+		uint32_t acc = 0;
+		for (size_t k = 0; k < n; k += NMULDOT)
+			acc += ITOBF obf_mul_dot_n(mula.data(), b.data(), NMULDOT).value();
+		obf_bench_sink = acc;
+	}));
+	report("ObfMulInt * ObfMulInt dot product", obf_bench_ns_per_op([&](size_t n) {
+		uint32_t acc = 0;
+		for (size_t k = 0; k < n; k += NMULDOT)
+			acc += ITOBF obf_mul_dot_n(mula.data(), mulb.data(), NMULDOT).value();
+		obf_bench_sink = acc;
+	}));
+}
+
+/* ************** DIVISION **************** */
+//ObfDivisor<>: grid index -> (row, col) with runtime grid width
+static volatile uint32_t bench_div_width = 1000;//volatile so that the compiler doesn't see it as a constant
+constexpr size_t NDIVGRID = 1 << 16;
+
+static void bench_div() {
+	std::cout << "--- division by rarely changing divisor (grid index -> row, col) ---" << std::endl;
+	auto report = [](const char* name, double ns) {
+		obf_bench_report(name, ns, "ns/index");
+	};
+	uint32_t w = bench_div_width;
+	std::vector<uint32_t> idx(NDIVGRID);
+	std::vector<OBFI3(uint32_t)> obfidx(NDIVGRID);
+	for (size_t i = 0; i < NDIVGRID; ++i) {
+		idx[i] = uint32_t(i * 37);
+		obfidx[i] = idx[i];
+	}
+	report("plain: i / w, i % w", obf_bench_ns_per_op([&](size_t n) {
+		uint32_t acc = 0;
+		for (size_t k = 0; k < n; k += NDIVGRID)
+			for (size_t i = 0; i < NDIVGRID; ++i)
+				acc += (idx[i] + uint32_t(k)) / w + (idx[i] + uint32_t(k)) % w;//+k: to prevent hoisting out of k-loop
+		obf_bench_sink = acc;
+	}));
+	OBFI3(uint32_t) obfw = w;
+	report("naive OBFI3(uint32_t): i / w, i % w", obf_bench_ns_per_op([&](size_t n) {
+		OBFI3(uint32_t) acc = 0;
+		for (size_t k = 0; k < n; k += NDIVGRID)
+			for (size_t i = 0; i < NDIVGRID; ++i)
+				acc += (obfidx[i] + uint32_t(k)) / obfw + (obfidx[i] + uint32_t(k)) % obfw;
+		obf_bench_sink = uint32_t(acc);
+	}));
+	ITOBF ObfDivisor<OBFI3(uint32_t)> div(w);
+	report("ObfDivisor<OBFI3(uint32_t)>::decode()", obf_bench_ns_per_op([&](size_t n) {
+		uint32_t acc = 0;
+		for (size_t k = 0; k < n; k += NDIVGRID) {
+			auto p = div.decode();
+			for (size_t i = 0; i < NDIVGRID; ++i) {
+				uint32_t x = obfidx[i] + uint32_t(k);
+				uint32_t q = p.div(x);
+				acc += q + (x - q * p.d);
+			}
+		}
+		obf_bench_sink = acc;
+	}));
+	std::vector<uint32_t> rows(NDIVGRID), cols(NDIVGRID);
+	report("obf_divmod_n()", obf_bench_ns_per_op([&](size_t n) {
+		for (size_t k = 0; k < n; k += NDIVGRID)
+			ITOBF obf_divmod_n(obfidx.data(), NDIVGRID, div, rows.data(), cols.data());
+		obf_bench_sink = rows[NDIVGRID-1] + cols[NDIVGRID-1];
+	}));
+	report("ObfDivisor<>::div()/mod(), one-off", obf_bench_ns_per_op([&](size_t n) {
+		uint32_t acc = 0;
+		for (size_t k = 0; k < n; k += NDIVGRID)
+			for (size_t i = 0; i < NDIVGRID; ++i)
+				acc += div.div(obfidx[i] + uint32_t(k)) + div.mod(obfidx[i] + uint32_t(k));
+		obf_bench_sink = acc;
+	}));
+}
+
+int main() {
+	bench_literals();
+	bench_entities();
+	bench_cold_literals();
+	bench_log();
+	bench_dump_decode();
+	bench_persist();
+	bench_delta();
+	bench_config();
+	bench_ct_compare();
+	bench_algorithms();
+	bench_parallel();
+	bench_checksum();
+	bench_rng();
+	bench_arena();
+	bench_layout();
+	bench_mul();
+	bench_div();
+	return 0;
+}
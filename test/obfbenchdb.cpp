@@ -0,0 +1,405 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+//BENCHMARK RESULTS STORE. Keeps obfbench results in a JSON-lines file (one line per benchmark per run), 
+//  and compares two commits using Mann-Whitney U test over repeated runs
+//  append: obfbenchdb append db.jsonl commit seed compiler flags run [obfbench-output.txt]  (reads stdin if no file)
+//  compare: obfbenchdb compare db.jsonl base-commit new-commit [-alpha A] [-threshold PCT]
+//    reports benchmarks where new-commit is slower (by more than PCT% in medians, with two-sided p < A); 
+//    exit code is 1 if there are any such regressions - intended to be run from CI
+//  Results are compared only within the same seed+compiler+flags; "slower" means larger for time units (ns/..., cycles/...), 
+//    and smaller for throughput units (.../s)
+//  (see nix/randomtest.sh and win/randomtest.bat, which append to the store automatically)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+struct ObfBenchRecord {
+	std::string commit;
+	std::string seed;
+	std::string compiler;
+	std::string flags;
+	int run = 0;
+	std::string bench;
+	double value = 0;
+	std::string unit;
+};
+
+static std::string json_escape(const std::string& s) {
+	std::string ret;
+	for(char c:s) {
+		if(c=='"' || c=='\\') {
+			ret += '\\';
+			ret += c;
+		}
+		else if((unsigned char)c < 0x20) {
+			char buf[8];
+			snprintf(buf,sizeof(buf),"\\u%04x",(unsigned)(unsigned char)c);
+			ret += buf;
+		}
+		else
+			ret += c;
+	}
+	return ret;
+}
+
+static std::string to_json(const ObfBenchRecord& r) {
+	char value[32];
+	snprintf(value,sizeof(value),"%.17g",r.value);
+	return "{\"commit\":\"" + json_escape(r.commit) + "\",\"seed\":\"" + json_escape(r.seed) + 
+		"\",\"compiler\":\"" + json_escape(r.compiler) + "\",\"flags\":\"" + json_escape(r.flags) + 
+		"\",\"run\":" + std::to_string(r.run) + ",\"bench\":\"" + json_escape(r.bench) + 
+		"\",\"value\":" + value + ",\"unit\":\"" + json_escape(r.unit) + "\"}";
+}
+
+//parsing only what to_json() writes: flat object of strings and numbers
+static bool from_json(const std::string& line, ObfBenchRecord& r) {
+	std::map<std::string,std::string> fields;
+	size_t i = 0;
+	auto skip_ws = [&]() { while(i < line.size() && isspace((unsigned char)line[i])) ++i; };
+	auto parse_string = [&](std::string& out) {
+		if(i >= line.size() || line[i] != '"')
+			return false;
+		++i;
+		while(i < line.size() && line[i] != '"') {
+			if(line[i] == '\\' && i + 1 < line.size()) {
+				++i;
+				if(line[i] == 'u' && i + 4 < line.size()) {
+					out += char(strtol(line.substr(i+1,4).c_str(),nullptr,16));
+					i += 5;
+					continue;
+				}
+			}
+			out += line[i++];
+		}
+		if(i >= line.size())
+			return false;
+		++i;
+		return true;
+	};
+	skip_ws();
+	if(i >= line.size() || line[i] != '{')
+		return false;
+	++i;
+	for(;;) {
+		skip_ws();
+		std::string key, value;
+		if(!parse_string(key))
+			return false;
+		skip_ws();
+		if(i >= line.size() || line[i] != ':')
+			return false;
+		++i;
+		skip_ws();
+		if(i < line.size() && line[i] == '"') {
+			if(!parse_string(value))
+				return false;
+		}
+		else {
+			while(i < line.size() && line[i] != ',' && line[i] != '}' && !isspace((unsigned char)line[i]))
+				value += line[i++];
+		}
+		fields[key] = value;
+		skip_ws();
+		if(i < line.size() && line[i] == ',') {
+			++i;
+			continue;
+		}
+		if(i < line.size() && line[i] == '}')
+			break;
+		return false;
+	}
+	if(!fields.count("bench") || !fields.count("value"))
+		return false;
+	r.commit = fields["commit"];
+	r.seed = fields["seed"];
+	r.compiler = fields["compiler"];
+	r.flags = fields["flags"];
+	r.run = atoi(fields["run"].c_str());
+	r.bench = fields["bench"];
+	r.value = atof(fields["value"].c_str());
+	r.unit = fields["unit"];
+	return true;
+}
+
+//obfbench output: "--- section ---" headers, result lines (obf_bench_report(): name in 48 columns, value, unit), 
+//  and indented informational lines; anything else is reported as unparseable (so results are never dropped silently)
+static void parse_obfbench_output(std::istream& in, const ObfBenchRecord& proto, std::vector<ObfBenchRecord>& out) {
+	std::string section;
+	std::string line;
+	size_t lineno = 0;
+	while(std::getline(in,line)) {
+		++lineno;
+		if(!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if(line.empty() || isspace((unsigned char)line[0]))
+			continue;
+		if(line.compare(0,3,"---") == 0) {
+			size_t b = line.find_first_not_of("- ");
+			size_t e = line.find_last_not_of("- ");
+			section = b == std::string::npos ? "" : line.substr(b,e-b+1);
+			continue;
+		}
+		const char* rest = line.size() > 48 && line[47] == ' ' ? line.c_str() + 48 : nullptr;
+		char* end = nullptr;
+		double v = rest ? strtod(rest,&end) : 0;
+		if(!rest || end == rest) {
+			std::cerr << "obfbenchdb: WARNING: cannot parse obfbench output line " << lineno << ", ignored: " << line << std::endl;
+			continue;
+		}
+		std::string name = line.substr(0,48);
+		while(!name.empty() && isspace((unsigned char)name.back()))
+			name.pop_back();
+		std::string unit = end;
+		while(!unit.empty() && isspace((unsigned char)unit.front()))
+			unit.erase(0,1);
+		while(!unit.empty() && isspace((unsigned char)unit.back()))
+			unit.pop_back();
+		ObfBenchRecord r = proto;
+		r.bench = section.empty() ? name : section + ": " + name;//the same name can appear in different sections
+		r.value = v;
+		r.unit = unit;
+		out.push_back(r);
+	}
+}
+
+//MANN-WHITNEY U
+//  two-sided p-value; exact distribution for small samples, normal approximation with tie correction otherwise
+
+static double mann_whitney_u(const std::vector<double>& a, const std::vector<double>& b, double& tie_term) {
+	std::vector<std::pair<double,int>> all;
+	for(double x:a)
+		all.push_back({x,0});
+	for(double x:b)
+		all.push_back({x,1});
+	std::sort(all.begin(),all.end());
+	double ranksum_a = 0;
+	tie_term = 0;
+	for(size_t i = 0; i < all.size();) {
+		size_t j = i;
+		while(j < all.size() && all[j].first == all[i].first)
+			++j;
+		double rank = (double(i) + double(j) + 1) / 2;//average of 1-based ranks i+1..j
+		for(size_t k = i; k < j; ++k)
+			if(all[k].second == 0)
+				ranksum_a += rank;
+		double t = double(j - i);
+		tie_term += t * t * t - t;
+		i = j;
+	}
+	double na = double(a.size());
+	return ranksum_a - na * (na + 1) / 2;
+}
+
+static double mann_whitney_exact_p(size_t n1, size_t n2, double u) {
+	//cnt[i][j][k]: number of orderings of i a's and j b's with U == k
+	size_t umax = n1 * n2;
+	std::vector<std::vector<std::vector<double>>> cnt(n1+1, std::vector<std::vector<double>>(n2+1, std::vector<double>(umax+1,0.)));
+	for(size_t i = 0; i <= n1; ++i) {
+		for(size_t j = 0; j <= n2; ++j) {
+			if(i == 0 || j == 0) {
+				cnt[i][j][0] = 1;
+				continue;
+			}
+			for(size_t k = 0; k <= i * j; ++k)
+				cnt[i][j][k] = (k >= j ? cnt[i-1][j][k-j] : 0.) + cnt[i][j-1][k];
+		}
+	}
+	double total = 0;
+	for(double c:cnt[n1][n2])
+		total += c;
+	double ulow = std::min(u, double(umax) - u);
+	double tail = 0;
+	for(size_t k = 0; double(k) <= ulow + 1e-9; ++k)
+		tail += cnt[n1][n2][k];
+	return std::min(1., 2 * tail / total);
+}
+
+static double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+	double tie_term;
+	double u = mann_whitney_u(a,b,tie_term);
+	double n1 = double(a.size()), n2 = double(b.size());
+	if(a.size() + b.size() <= 20)//ties (which are mostly within the same commit, due to rounding in obfbench output) are handled via mid-ranks
+		return mann_whitney_exact_p(a.size(),b.size(),u);
+	double n = n1 + n2;
+	double mu = n1 * n2 / 2;
+	double sigma = sqrt(n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1))));
+	if(sigma == 0)
+		return 1.;
+	double z = (fabs(u - mu) - 0.5) / sigma;//with continuity correction
+	if(z < 0)
+		z = 0;
+	return erfc(z / sqrt(2.));
+}
+
+static double median(std::vector<double> v) {
+	std::sort(v.begin(),v.end());
+	size_t n = v.size();
+	return n % 2 ? v[n/2] : (v[n/2-1] + v[n/2]) / 2;
+}
+
+static bool higher_is_worse(const std::string& unit) {
+	return unit.size() < 2 || unit.compare(unit.size()-2,2,"/s") != 0;
+}
+
+static int cmd_append(int argc, char** argv) {
+	if(argc < 8) {
+		std::cerr << "Usage: obfbenchdb append db.jsonl commit seed compiler flags run [obfbench-output.txt]" << std::endl;
+		return 2;
+	}
+	ObfBenchRecord proto;
+	proto.commit = argv[3];
+	proto.seed = argv[4];
+	proto.compiler = argv[5];
+	proto.flags = argv[6];
+	proto.run = atoi(argv[7]);
+	std::vector<ObfBenchRecord> records;
+	if(argc > 8) {
+		std::ifstream in(argv[8]);
+		if(!in) {
+			std::cerr << "obfbenchdb: cannot open " << argv[8] << std::endl;
+			return 2;
+		}
+		parse_obfbench_output(in,proto,records);
+	}
+	else
+		parse_obfbench_output(std::cin,proto,records);
+	std::ofstream db(argv[2],std::ios::app);
+	if(!db) {
+		std::cerr << "obfbenchdb: cannot open " << argv[2] << " for writing" << std::endl;
+		return 2;
+	}
+	for(const ObfBenchRecord& r:records)
+		db << to_json(r) << '\n';
+	std::cout << "obfbenchdb: " << records.size() << " result(s) appended to " << argv[2] << std::endl;
+	return records.empty() ? 2 : 0;
+}
+
+static int cmd_compare(int argc, char** argv) {
+	double alpha = 0.01;
+	double threshold = 5.;//percent
+	std::vector<const char*> pos;
+	for(int i = 2; i < argc; ++i) {
+		if(strcmp(argv[i],"-alpha")==0 && i+1 < argc)
+			alpha = atof(argv[++i]);
+		else if(strcmp(argv[i],"-threshold")==0 && i+1 < argc)
+			threshold = atof(argv[++i]);
+		else
+			pos.push_back(argv[i]);
+	}
+	if(pos.size() != 3) {
+		std::cerr << "Usage: obfbenchdb compare db.jsonl base-commit new-commit [-alpha A] [-threshold PCT]" << std::endl;
+		return 2;
+	}
+	std::ifstream db(pos[0]);
+	if(!db) {
+		std::cerr << "obfbenchdb: cannot open " << pos[0] << std::endl;
+		return 2;
+	}
+	std::string base = pos[1], cur = pos[2];
+	using Key = std::tuple<std::string,std::string,std::string,std::string>;//seed, compiler, flags, bench
+	std::map<Key,std::vector<double>> base_values, cur_values;
+	std::map<Key,std::string> units;
+	std::string line;
+	int nbad = 0;
+	while(std::getline(db,line)) {
+		if(line.empty())
+			continue;
+		ObfBenchRecord r;
+		if(!from_json(line,r)) {
+			++nbad;
+			continue;
+		}
+		Key key(r.seed,r.compiler,r.flags,r.bench);
+		if(r.commit == base)
+			base_values[key].push_back(r.value);
+		else if(r.commit == cur)
+			cur_values[key].push_back(r.value);
+		else
+			continue;
+		units[key] = r.unit;
+	}
+	if(nbad)
+		std::cerr << "obfbenchdb: " << nbad << " malformed line(s) skipped" << std::endl;
+
+	int ncompared = 0, nregressions = 0, nimprovements = 0;
+	for(auto& it:cur_values) {
+		auto found = base_values.find(it.first);
+		if(found == base_values.end())
+			continue;
+		const std::vector<double>& a = found->second;
+		const std::vector<double>& b = it.second;
+		if(a.size() < 3 || b.size() < 3)//with fewer runs, even exact test cannot reach p < 0.1
+			continue;
+		++ncompared;
+		double ma = median(a), mb = median(b);
+		double change = ma != 0 ? (mb - ma) / fabs(ma) * 100. : 0.;
+		const std::string& unit = units[it.first];
+		double worse = higher_is_worse(unit) ? change : -change;
+		double p = mann_whitney_p(a,b);
+		if(p >= alpha || fabs(change) <= threshold)
+			continue;
+		const Key& k = it.first;
+		const char* verdict = worse > 0 ? "REGRESSION" : "improvement";
+		if(worse > 0)
+			++nregressions;
+		else
+			++nimprovements;
+		printf("%-11s %+7.1f%% (p=%.4f, n=%zu/%zu) %s [%s, %s, seed=%s]: %g -> %g %s\n", verdict, change, p, a.size(), b.size(),
+			std::get<3>(k).c_str(), std::get<1>(k).c_str(), std::get<2>(k).c_str(), std::get<0>(k).c_str(), ma, mb, unit.c_str());
+	}
+	std::cout << ncompared << " benchmark(s) compared, " << nregressions << " regression(s), " << nimprovements << " improvement(s) (alpha=" 
+		<< alpha << ", threshold=" << threshold << "%)" << std::endl;
+	if(ncompared == 0)
+		std::cerr << "obfbenchdb: nothing to compare - need at least 3 runs of both " << base << " and " << cur << " with the same seed/compiler/flags" << std::endl;
+	return nregressions ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	if(argc >= 2 && strcmp(argv[1],"append")==0)
+		return cmd_append(argc,argv);
+	if(argc >= 2 && strcmp(argv[1],"compare")==0)
+		return cmd_compare(argc,argv);
+	std::cerr << "Usage: obfbenchdb append db.jsonl commit seed compiler flags run [obfbench-output.txt]" << std::endl;
+	std::cerr << "       obfbenchdb compare db.jsonl base-commit new-commit [-alpha A] [-threshold PCT]" << std::endl;
+	return 2;
+}
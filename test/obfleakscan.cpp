@@ -0,0 +1,439 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+//PLAINTEXT LEAK SCANNER. Harvests literals which are supposed to be obfuscated (OBFS?L()/OBFS?L_COLD()/ITHARE_OBF_STRLIT?() strings, 
+//  and OBFI?L()/ITHARE_OBF_INTLIT?() integer constants) from sources, and searches build outputs for their plaintext
+//  All patterns are matched in a single pass per file (Aho-Corasick automaton with dense transition table, 
+//    i.e. one table lookup per byte regardless of number of patterns); files are scanned in parallel
+//  Integer constants are searched as 4- and 8-byte little-endian; small ones (below -minint) are skipped, as they occur everywhere
+//  Exit code is non-zero if there is any plaintext hit; randomtest.sh/.bat run it once per session
+//    over all obfuscated executables of the session (see randomtestgen -leakscan)
+//  Usage: obfleakscan [-j N] [-minint N] [-src file.cpp]... [-str literal]... [-list file-with-paths] binary1 [binary2 ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+struct ObfLeakPattern {
+	std::string bytes;
+	std::string what;//printable description
+	std::string site;//file:line where it was harvested, if any
+};
+
+//HARVESTING
+
+static bool is_ident_char(char c) {
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+//matching macro name at pos: prefix, then one digit, then one of suffixes
+static size_t match_macro(const std::string& src, size_t pos, const char* prefix, const std::vector<const char*>& suffixes) {
+	size_t n = strlen(prefix);
+	if(src.compare(pos,n,prefix) != 0)
+		return 0;
+	if(pos > 0 && is_ident_char(src[pos-1]))
+		return 0;
+	size_t p = pos + n;
+	if(p >= src.size() || src[p] < '0' || src[p] > '6')
+		return 0;
+	++p;
+	for(const char* suffix:suffixes) {
+		size_t m = strlen(suffix);
+		if(src.compare(p,m,suffix) == 0 && (p + m >= src.size() || !is_ident_char(src[p+m])))
+			return p + m - pos;
+	}
+	return 0;
+}
+
+static size_t skip_ws(const std::string& src, size_t p) {
+	while(p < src.size() && isspace((unsigned char)src[p]))
+		++p;
+	return p;
+}
+
+//parses one or more adjacent "..." literals at p (with C escapes); returns position after the last one, or 0
+static size_t parse_string_literal(const std::string& src, size_t p, std::string& out) {
+	size_t start = p;
+	while(p < src.size() && src[p] == '"') {
+		++p;
+		while(p < src.size() && src[p] != '"') {
+			char c = src[p++];
+			if(c != '\\') {
+				out += c;
+				continue;
+			}
+			if(p >= src.size())
+				return 0;
+			c = src[p++];
+			switch(c) {
+				case 'n': out += '\n'; break;
+				case 't': out += '\t'; break;
+				case 'r': out += '\r'; break;
+				case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': {
+					int v = c - '0';
+					for(int i = 0; i < 2 && p < src.size() && src[p] >= '0' && src[p] <= '7'; ++i)
+						v = v * 8 + (src[p++] - '0');
+					out += char(v);
+					break;
+				}
+				case 'x': {
+					int v = 0;
+					while(p < src.size() && isxdigit((unsigned char)src[p])) {
+						char h = char(tolower((unsigned char)src[p++]));
+						v = v * 16 + (h <= '9' ? h - '0' : h - 'a' + 10);
+					}
+					out += char(v);
+					break;
+				}
+				default: out += c; break;//\\, \", \', \?
+			}
+		}
+		if(p >= src.size())
+			return 0;
+		++p;
+		p = skip_ws(src,p);
+	}
+	return p > start ? p : 0;
+}
+
+//integer literal (dec/hex/oct/bin, with ' separators and suffixes), optionally negated; the whole argument must be the literal
+static bool parse_int_literal(std::string arg, int64_t& out) {
+	arg.erase(std::remove_if(arg.begin(),arg.end(),[](char c) { return isspace((unsigned char)c) || c == '\''; }),arg.end());
+	bool neg = false;
+	if(!arg.empty() && arg[0] == '-') {
+		neg = true;
+		arg.erase(0,1);
+	}
+	while(!arg.empty() && (arg.back() == 'u' || arg.back() == 'U' || arg.back() == 'l' || arg.back() == 'L'))
+		arg.pop_back();
+	if(arg.empty() || !isdigit((unsigned char)arg[0]))
+		return false;
+	int base = 10;
+	size_t p = 0;
+	if(arg.size() > 2 && arg[0] == '0' && (arg[1] == 'x' || arg[1] == 'X')) {
+		base = 16;
+		p = 2;
+	}
+	else if(arg.size() > 2 && arg[0] == '0' && (arg[1] == 'b' || arg[1] == 'B')) {
+		base = 2;
+		p = 2;
+	}
+	else if(arg.size() > 1 && arg[0] == '0')
+		base = 8;
+	char* end = nullptr;
+	uint64_t v = strtoull(arg.c_str()+p,&end,base);
+	if(*end != 0)
+		return false;
+	out = neg ? -int64_t(v) : int64_t(v);
+	return true;
+}
+
+static std::string printable(const std::string& s) {
+	std::string ret;
+	for(char c:s) {
+		if(isprint((unsigned char)c) && c != '"' && c != '\\')
+			ret += c;
+		else {
+			char buf[8];
+			snprintf(buf,sizeof(buf),"\\x%02x",(unsigned)(unsigned char)c);
+			ret += buf;
+		}
+	}
+	return ret;
+}
+
+static void add_int_patterns(int64_t v, const std::string& site, std::vector<ObfLeakPattern>& patterns) {
+	char what[64];
+	snprintf(what,sizeof(what),"int %lld",(long long)v);
+	uint64_t u = uint64_t(v);
+	std::string le8;
+	for(int i = 0; i < 8; ++i)
+		le8 += char(uint8_t(u >> (8*i)));
+	if(v >= INT32_MIN && v <= int64_t(UINT32_MAX))//fits into 4 bytes either as signed or unsigned
+		patterns.push_back({le8.substr(0,4),std::string(what) + " (4 bytes LE)",site});
+	patterns.push_back({le8,std::string(what) + " (8 bytes LE)",site});
+}
+
+static bool harvest(const char* fname, int64_t minint, std::vector<ObfLeakPattern>& patterns) {
+	std::ifstream f(fname,std::ios::binary);
+	if(!f)
+		return false;
+	std::string src((std::istreambuf_iterator<char>(f)),std::istreambuf_iterator<char>());
+	static const std::vector<const char*> str_suffixes = { "L_COLD", "L" };
+	static const std::vector<const char*> strlit_suffixes = { "_COLD", "" };
+	static const std::vector<const char*> int_suffixes = { "LI", "L" };
+	static const std::vector<const char*> intlit_suffixes = { "I", "" };
+	size_t line = 1;
+	size_t lastpos = 0;
+	for(size_t pos = 0; pos < src.size(); ++pos) {
+		if(src[pos] != 'O' && src[pos] != 'I')
+			continue;
+		bool is_str = true;
+		size_t len = match_macro(src,pos,"OBFS",str_suffixes);
+		if(!len) len = match_macro(src,pos,"ITHARE_OBF_STRLIT",strlit_suffixes);
+		if(!len) len = match_macro(src,pos,"ITHARE_KSCOPE_STRLIT",strlit_suffixes);
+		if(!len) {
+			is_str = false;
+			len = match_macro(src,pos,"OBFI",int_suffixes);
+			if(!len) len = match_macro(src,pos,"ITHARE_OBF_INTLIT",intlit_suffixes);
+			if(!len) len = match_macro(src,pos,"ITHARE_KSCOPE_INTLIT",intlit_suffixes);
+		}
+		if(!len)
+			continue;
+		size_t p = skip_ws(src,pos+len);
+		if(p >= src.size() || src[p] != '(')
+			continue;//#define etc.
+		line += std::count(src.begin()+lastpos,src.begin()+pos,'\n');
+		lastpos = pos;
+		std::string site = std::string(fname) + ":" + std::to_string(line);
+		p = skip_ws(src,p+1);
+		if(is_str) {
+			std::string s;
+			if(parse_string_literal(src,p,s) && !s.empty())
+				patterns.push_back({s,"\"" + printable(s) + "\"",site});
+		}
+		else {//last top-level argument: OBFI?L(value) or OBFI?L(type,value)
+			int depth = 0;
+			size_t argstart = p;
+			for(; p < src.size(); ++p) {
+				if(src[p] == '(')
+					++depth;
+				else if(src[p] == ')') {
+					if(depth == 0)
+						break;
+					--depth;
+				}
+				else if(src[p] == ',' && depth == 0)
+					argstart = p + 1;
+			}
+			int64_t v;
+			if(p < src.size() && parse_int_literal(src.substr(argstart,p-argstart),v) && (v >= minint || v <= -minint))
+				add_int_patterns(v,site,patterns);
+		}
+	}
+	return true;
+}
+
+//AHO-CORASICK
+//  dense transitions (256 per state): matching is a single table lookup per byte, with no failure-link chasing at scan time
+
+class ObfLeakMatcher {
+	std::vector<std::array<uint32_t,256>> delta;
+	std::vector<std::vector<uint32_t>> out;//patterns ending at each state (including those reachable via failure links)
+
+	public:
+	explicit ObfLeakMatcher(const std::vector<ObfLeakPattern>& patterns) {
+		delta.emplace_back();
+		delta[0].fill(0);
+		out.emplace_back();
+		const uint32_t none = UINT32_MAX;
+		std::vector<std::array<uint32_t,256>> trie(1);
+		trie[0].fill(none);
+		for(uint32_t i = 0; i < patterns.size(); ++i) {
+			uint32_t s = 0;
+			for(unsigned char c:patterns[i].bytes) {
+				if(trie[s][c] == none) {
+					trie[s][c] = uint32_t(trie.size());
+					trie.emplace_back();
+					trie.back().fill(none);
+				}
+				s = trie[s][c];
+			}
+			if(out.size() < trie.size())
+				out.resize(trie.size());
+			out[s].push_back(i);
+		}
+		out.resize(trie.size());
+		delta.resize(trie.size());
+		std::vector<uint32_t> fail(trie.size(),0);
+		std::vector<uint32_t> queue;//BFS order, so that fail[] of shallower states is ready
+		for(int c = 0; c < 256; ++c) {
+			uint32_t t = trie[0][c];
+			delta[0][c] = t == none ? 0 : t;
+			if(t != none)
+				queue.push_back(t);
+		}
+		for(size_t qi = 0; qi < queue.size(); ++qi) {
+			uint32_t s = queue[qi];
+			const std::vector<uint32_t>& fout = out[fail[s]];
+			out[s].insert(out[s].end(),fout.begin(),fout.end());
+			for(int c = 0; c < 256; ++c) {
+				uint32_t t = trie[s][c];
+				if(t == none)
+					delta[s][c] = delta[fail[s]][c];
+				else {
+					delta[s][c] = t;
+					fail[t] = delta[fail[s]][c];
+					queue.push_back(t);
+				}
+			}
+		}
+	}
+
+	//f(pattern_index, end_offset) for every occurrence
+	template<class F>
+	void scan(const uint8_t* data, size_t n, F&& f) const {
+		uint32_t s = 0;
+		for(size_t i = 0; i < n; ++i) {
+			s = delta[s][data[i]];
+			if(!out[s].empty())//rare
+				for(uint32_t p:out[s])
+					f(p,i+1);
+		}
+	}
+};
+
+struct ObfLeakFileResult {
+	bool ok = true;
+	std::vector<size_t> hits;//per pattern
+	std::vector<size_t> first;//per pattern: offset of the first hit
+};
+
+int main(int argc, char** argv) {
+	unsigned nthreads = std::max(1u,std::thread::hardware_concurrency());
+	int64_t minint = 65536;
+	std::vector<const char*> srcs;
+	std::vector<std::string> strs;
+	std::vector<std::string> files;
+	for(int i=1; i < argc; ++i) {
+		if(strcmp(argv[i],"-j")==0 && i+1 < argc)
+			nthreads = std::max(1,atoi(argv[++i]));
+		else if(strcmp(argv[i],"-minint")==0 && i+1 < argc)
+			minint = atoll(argv[++i]);
+		else if(strcmp(argv[i],"-src")==0 && i+1 < argc)
+			srcs.push_back(argv[++i]);
+		else if(strcmp(argv[i],"-str")==0 && i+1 < argc)
+			strs.push_back(argv[++i]);
+		else if(strcmp(argv[i],"-list")==0 && i+1 < argc) {
+			std::ifstream list(argv[++i]);
+			if(!list) {
+				std::cerr << "obfleakscan: cannot open " << argv[i] << std::endl;
+				return 2;
+			}
+			std::string line;
+			while(std::getline(list,line)) {
+				while(!line.empty() && isspace((unsigned char)line.back()))//\r, and trailing spaces from "echo ... >>list"
+					line.pop_back();
+				if(!line.empty())
+					files.push_back(line);
+			}
+		}
+		else if(argv[i][0]=='-') {
+			std::cerr << "Usage: obfleakscan [-j N] [-minint N] [-src file.cpp]... [-str literal]... [-list file-with-paths] binary1 [binary2 ...]" << std::endl;
+			return 2;
+		}
+		else
+			files.push_back(argv[i]);
+	}
+
+	std::vector<ObfLeakPattern> patterns;
+	for(const char* src:srcs) {
+		if(!harvest(src,minint,patterns)) {
+			std::cerr << "obfleakscan: cannot open " << src << std::endl;
+			return 2;
+		}
+	}
+	for(const std::string& s:strs)
+		patterns.push_back({s,"\"" + printable(s) + "\"","-str"});
+	if(patterns.empty()) {
+		std::cerr << "obfleakscan: no patterns (no OBFS?L()/OBFI?L() sites found, and no -str given)" << std::endl;
+		return 2;
+	}
+	if(files.empty()) {
+		std::cerr << "obfleakscan: no files to scan" << std::endl;
+		return 2;
+	}
+
+	ObfLeakMatcher matcher(patterns);
+	std::vector<ObfLeakFileResult> results(files.size());
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		std::vector<uint8_t> buf;
+		for(;;) {
+			size_t idx = next++;
+			if(idx >= files.size())
+				return;
+			ObfLeakFileResult& r = results[idx];
+			std::ifstream f(files[idx],std::ios::binary|std::ios::ate);
+			if(!f) {
+				r.ok = false;
+				continue;
+			}
+			buf.resize(size_t(f.tellg()));
+			f.seekg(0);
+			f.read(reinterpret_cast<char*>(buf.data()),std::streamsize(buf.size()));
+			r.hits.assign(patterns.size(),0);
+			r.first.assign(patterns.size(),0);
+			matcher.scan(buf.data(),buf.size(),[&](uint32_t p, size_t end) {
+				if(r.hits[p]++ == 0)
+					r.first[p] = end - patterns[p].bytes.size();
+			});
+		}
+	};
+	nthreads = unsigned(std::min<size_t>(nthreads,files.size()));
+	std::vector<std::thread> threads;
+	for(unsigned i = 1; i < nthreads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for(std::thread& t:threads)
+		t.join();
+
+	size_t nleaks = 0, nerrors = 0;
+	for(size_t i = 0; i < files.size(); ++i) {
+		const ObfLeakFileResult& r = results[i];
+		if(!r.ok) {
+			std::cerr << "obfleakscan: cannot open " << files[i] << std::endl;
+			++nerrors;
+			continue;
+		}
+		for(size_t p = 0; p < patterns.size(); ++p) {
+			if(!r.hits[p])
+				continue;
+			++nleaks;
+			printf("%s: PLAINTEXT %s (%s) at offset 0x%zx, %zu time(s)\n",files[i].c_str(),patterns[p].what.c_str(),patterns[p].site.c_str(),r.first[p],r.hits[p]);
+		}
+	}
+	std::cout << files.size() << " file(s) scanned for " << patterns.size() << " pattern(s), " << nleaks << " plaintext hit(s)" << std::endl;
+	if(nerrors)
+		return 2;
+	return nleaks ? 1 : 0;
+}
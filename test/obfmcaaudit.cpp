@@ -0,0 +1,274 @@
+/*
+
+Copyright (c) 2018, ITHare.com
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+//STATIC PER-SITE COST AUDIT. Runs llvm-mca over assembly generated with -DITHARE_OBF_DBG_MCA_MARKERS,
+//  and compares estimated cost of each ITHARE_OBF_MCA_BEGIN()/ITHARE_OBF_MCA_END() region against its declared OBFX() budget
+//  Exit code is non-zero if any of the sites exceeds its budget by more than -factor times, if there are no sites at all,
+//    or if a site with declared budget doesn't show up in llvm-mca output (i.e. markers got lost); intended to be run from CI 
+//  (see nix/mcaaudit.sh)
+//  Audited sites live in this file too (below); with -DITHARE_OBF_MCA_SITES, it compiles into them instead of into the tool, 
+//    so that obftest.cpp doesn't need to be restructured for the audit
+
+#ifdef ITHARE_OBF_MCA_SITES
+
+#include <stdexcept>
+#include <string>
+#include "../src/obf.h"
+
+//AUDITED SITES
+//  ITHARE_OBF_MCA_BEGIN()/END(): each obfuscated operation is a separate site; budget of the site is the highest OBFX() involved
+//  NB: the same as factorial() in obftest.cpp, split into separate statements so that each operation can be marked 
+ITHARE_OBF_NOINLINE OBFI6(uint64_t) obf_mca_factorial(OBFI6(int64_t) x) {
+	ITHARE_OBF_MCA_BEGIN(factorial_check,6);
+	bool negative = x < 0;
+	ITHARE_OBF_MCA_END(factorial_check);
+	if (negative)
+		throw std::runtime_error(std::string(OBFS5L("Negative argument to factorial!")));
+	OBFI3(int64_t) ret = 1;
+	for (OBFI3(int64_t) i = 1;; ) {
+		ITHARE_OBF_MCA_BEGIN(factorial_cond,6);
+		bool more = i <= x;
+		ITHARE_OBF_MCA_END(factorial_cond);
+		if (!more)
+			break;
+		ITHARE_OBF_MCA_BEGIN(factorial_mul,3);
+		ret *= i;
+		ITHARE_OBF_MCA_END(factorial_mul);
+		ITHARE_OBF_MCA_BEGIN(factorial_incr,3);
+		++i;
+		ITHARE_OBF_MCA_END(factorial_incr);
+	}
+	ITHARE_OBF_MCA_BEGIN(factorial_ret,6);
+	OBFI6(uint64_t) ret6 = ret;
+	ITHARE_OBF_MCA_END(factorial_ret);
+	return ret6;
+}
+
+#else //ITHARE_OBF_MCA_SITES
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+struct ObfMcaSite {
+	std::string name;
+	int obf_level = -1;
+	double latency = -1;//Total Cycles for one iteration
+	double rthroughput = -1;//Block RThroughput
+};
+
+inline bool starts_with(std::string a,std::string b) {
+	return a.compare(0,b.length(),b) == 0;
+}
+
+static double obf_budget_cycles(int obf_level) {
+	//the same as in obf.h: OBFX() means 'add no more than 10^(X/2) CPU cycles'
+	return pow(10., obf_level / 2.);
+}
+
+static std::string marker_name(const std::string& line, const std::string& marker) {
+	size_t pos = line.find(marker);
+	if(pos == std::string::npos)
+		return "";
+	std::string ret = line.substr(pos+marker.length());
+	while(!ret.empty() && isspace((unsigned char)ret.back()))
+		ret.pop_back();
+	return ret;
+}
+
+//nonempty: regions which have at least one instruction between markers 
+//  (llvm-mca silently skips empty ones; a region is empty if the compiler moved all its code out of the markers)
+static bool read_budgets(const char* fname, std::map<std::string,int>& budgets, std::map<std::string,bool>& nonempty) {
+	std::ifstream f(fname);
+	if(!f)
+		return false;
+	static const std::string marker = "# ITHARE-OBF-MCA-BUDGET ";
+	std::vector<std::string> open;
+	std::string line;
+	while(std::getline(f,line)) {
+		std::string begin = marker_name(line,"# LLVM-MCA-BEGIN ");
+		std::string end = marker_name(line,"# LLVM-MCA-END ");
+		if(begin != "") {
+			open.push_back(begin);
+			nonempty[begin];//creating as false if not there yet
+			continue;
+		}
+		if(end != "") {
+			auto found = std::find(open.begin(),open.end(),end);
+			if(found != open.end())
+				open.erase(found);
+			continue;
+		}
+		size_t pos = line.find(marker);
+		if(pos != std::string::npos) {
+			std::string rest = line.substr(pos+marker.length());
+			size_t sp = rest.find(' ');
+			if(sp != std::string::npos)
+				budgets[rest.substr(0,sp)] = atoi(rest.c_str()+sp+1);
+			continue;
+		}
+		size_t b = line.find_first_not_of(" \t");
+		if(b == std::string::npos || line[b] == '#' || line[b] == '.' || line.back() == ':')
+			continue;//comment, directive, or label
+		for(const std::string& name:open)
+			nonempty[name] = true;
+	}
+	return true;
+}
+
+static double value_after_colon(const std::string& line) {
+	size_t pos = line.find(':');
+	assert(pos != std::string::npos);
+	return atof(line.c_str()+pos+1);
+}
+
+static bool run_mca(std::string mca, std::string mcpu, const char* fname, std::vector<ObfMcaSite>& sites) {
+	std::string cmd = mca + " -iterations=1";//one iteration => 'Total Cycles' is a latency estimate
+	if(mcpu != "")
+		cmd += " -mcpu=" + mcpu;
+	cmd += std::string(" ") + fname + " 2>&1";
+	FILE* p = popen(cmd.c_str(),"r");
+	if(!p)
+		return false;
+	static const std::string region = "Code Region - ";
+	ObfMcaSite* current = nullptr;
+	char buf[1024];
+	while(fgets(buf,sizeof(buf),p)) {
+		std::string line(buf);
+		size_t pos = line.find(region);
+		if(pos != std::string::npos) {
+			ObfMcaSite site;
+			site.name = line.substr(pos+region.length());
+			while(!site.name.empty() && isspace((unsigned char)site.name.back()))
+				site.name.pop_back();
+			sites.push_back(site);
+			current = &sites.back();
+		}
+		else if(current && starts_with(line,"Total Cycles:"))
+			current->latency = value_after_colon(line);
+		else if(current && starts_with(line,"Block RThroughput:"))
+			current->rthroughput = value_after_colon(line);
+	}
+	return pclose(p) == 0;
+}
+
+int main(int argc, char** argv) {
+	double factor = 2.;
+	std::string mca = "llvm-mca";
+	std::string mcpu = "";
+	std::vector<const char*> files;
+	for(int i=1; i < argc; ++i) {
+		if(strcmp(argv[i],"-factor")==0 && i+1 < argc)
+			factor = atof(argv[++i]);
+		else if(strcmp(argv[i],"-mcpu")==0 && i+1 < argc)
+			mcpu = argv[++i];
+		else if(strcmp(argv[i],"-mca")==0 && i+1 < argc)
+			mca = argv[++i];
+		else if(argv[i][0]=='-') {
+			std::cerr << "Usage: obfmcaaudit [-factor F] [-mcpu CPU] [-mca path-to-llvm-mca] file1.s [file2.s ...]" << std::endl;
+			return 2;
+		}
+		else
+			files.push_back(argv[i]);
+	}
+	if(files.empty()) {
+		std::cerr << "obfmcaaudit: no .s files specified" << std::endl;
+		return 2;
+	}
+
+	int nviolations = 0;
+	int nsites = 0;
+	int nmissing = 0;
+	int nempty = 0;
+	for(const char* fname:files) {
+		std::map<std::string,int> budgets;
+		std::map<std::string,bool> nonempty;
+		if(!read_budgets(fname,budgets,nonempty)) {
+			std::cerr << "obfmcaaudit: cannot open " << fname << std::endl;
+			return 2;
+		}
+		std::vector<ObfMcaSite> sites;
+		if(!run_mca(mca,mcpu,fname,sites)) {
+			std::cerr << "obfmcaaudit: " << mca << " failed on " << fname << std::endl;
+			return 2;
+		}
+		std::map<std::string,int> seen;
+		for(ObfMcaSite& site:sites) {
+			++seen[site.name];
+			auto found = budgets.find(site.name);
+			if(found == budgets.end()) {
+				std::cout << fname << ": " << site.name << ": no ITHARE_OBF_MCA_BEGIN() budget, skipped" << std::endl;
+				continue;
+			}
+			site.obf_level = found->second;
+			double budget = obf_budget_cycles(site.obf_level);
+			bool violation = site.latency > budget * factor;
+			std::cout << fname << ": " << site.name << ": OBF" << site.obf_level << " budget=" << budget 
+				<< " latency=" << site.latency << " rthroughput=" << site.rthroughput 
+				<< (violation ? " EXCEEDS BUDGET" : "") << std::endl;
+			++nsites;
+			if(violation)
+				++nviolations;
+		}
+		for(auto& budget:budgets) {
+			if(seen.find(budget.first) != seen.end())
+				continue;
+			auto ne = nonempty.find(budget.first);
+			if(ne != nonempty.end() && !ne->second) {
+				std::cout << fname << ": " << budget.first << ": empty region (all the code was moved out of markers), nothing to audit" << std::endl;
+				++nempty;
+			}
+			else {
+				std::cout << fname << ": " << budget.first << ": has budget, but NOT FOUND in " << mca << " output" << std::endl;
+				++nmissing;
+			}
+		}
+	}
+	std::cout << nsites << " site(s) audited, " << nviolations << " over budget (factor=" << factor << "), " 
+		<< nmissing << " missing, " << nempty << " empty" << std::endl;
+	if(nsites == 0) {
+		std::cout << "obfmcaaudit: no sites audited (were the files compiled with -DITHARE_OBF_DBG_MCA_MARKERS?)" << std::endl;
+		return 1;
+	}
+	return nviolations || nmissing ? 1 : 0;
+}
+
+#endif //ITHARE_OBF_MCA_SITES
@@ -32,6 +32,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../../kscope/test/lest.hpp"
 #include "../src/obf.h"
+#include "../src/obf_lib.h"
+#include "../src/obf_parallel.h"
+#include "../src/obf_checksum.h"
+#include "../src/obf_rng.h"
+#include "../src/obf_arena.h"
+#include "../src/obf_struct.h"
+#include "../src/obf_mul.h"
+#include "../src/obf_div.h"
+#include "../src/obf_dump.h"
+#include "../src/obf_persist.h"
+#include "../src/obf_delta.h"
+#include "../src/obf_config.h"
+#define ITHARE_OBF_LOG_DECODER//obftest is both the logging app and its own decoder (the same sources with the same seed)
+#include "../src/obf_log.h"
+#undef ITHARE_OBF_LOG_DECODER
+#include <sstream>
+#include <algorithm>
+
+//with randomtestgen -unity, this file shares its TU with kscope test sources (and goes first there, see randomtestgen.cpp), 
+//  so file-level names (module, factorial(), ...) live in their own namespace, and macros are #undef'ed at the end
+namespace obftest {
 
 #ifdef ITHARE_OBF_TEST_NO_NAMESPACE
 using namespace ithare::obf;
@@ -53,7 +74,7 @@ private:
 	std::string message;
 };
 
-ITHARE_OBF_NOINLINE OBFI6(uint64_t) factorial(OBFI6(int64_t) x) {
+ITHARE_OBF_NOINLINE ITHARE_OBF_DEBUG_FLATTEN OBFI6(uint64_t) factorial(OBFI6(int64_t) x) {
 	//DBGPRINT(x)
 	if (x < 0)
 		throw MyException(OBFS5L("Negative argument to factorial!"));
@@ -66,8 +87,137 @@ ITHARE_OBF_NOINLINE OBFI6(uint64_t) factorial(OBFI6(int64_t) x) {
 	return ret;
 }
 
+//the same check as in factorial(), with the literal decoded by an outlined cold function instead of inline
+ITHARE_OBF_NOINLINE OBFI6(int64_t) obf_test_cold_check(OBFI6(int64_t) x) {
+	if (x < 0)
+		throw MyException(OBFS5L_COLD("Negative argument to obf_test_cold_check!"));
+	return x;
+}
+
+#ifdef ITHARE_OBF_SEED
+static_assert(ITOBF ObfSizeofReport<OBFI6(int64_t)>::is_obf_type && ITOBF ObfSizeofReport<OBFI0(uint8_t)>::is_obf_type);
+#else
+static_assert(!ITOBF ObfSizeofReport<OBFI6(int64_t)>::is_obf_type);//OBFI?(T) is plain T
+#endif
+static_assert(std::is_same<ITOBF ObfSizeofReport<OBFI3(uint16_t)>::plain_type, uint16_t>::value);
+
+#ifdef ITHARE_OBF_COMPACT
+ITHARE_OBF_ASSERT_COMPACT(OBFI6(int64_t));
+ITHARE_OBF_ASSERT_COMPACT(OBFI3(int64_t));
+#endif
+
 #define NBENCH 1000
 
+#define NCTELEMS 65536
+
+//obf_lib.h wrappers: obf_flag_is_constexpr versions MUST be usable within constant expressions
+//  (plain int32_t, as OBFI?() types are not literal types in all kscope configurations)
+constexpr int64_t obf_test_lib_constexpr() {
+	int32_t a[8] = {};
+	ITOBF obf_fill<ITOBF obf_flag_is_constexpr>(a, -3);
+	if (ITOBF obf_count<ITOBF obf_flag_is_constexpr>(a, -3) != 8)
+		return -1;
+	for (int i = 0; i < 8; ++i)
+		a[i] = i * 5 - 7;
+	if (ITOBF obf_find<ITOBF obf_flag_is_constexpr>(a, 13) != 4 || ITOBF obf_find<ITOBF obf_flag_is_constexpr>(a, 14) != 8)
+		return -2;
+	auto mm = ITOBF obf_minmax<ITOBF obf_flag_is_constexpr>(a);
+	if (mm.first != -7 || mm.second != 28)
+		return -3;
+	ITOBF obf_reverse<ITOBF obf_flag_is_constexpr>(a);
+	if (a[0] != 28 || a[7] != -7)
+		return -4;
+	return ITOBF obf_accumulate<ITOBF obf_flag_is_constexpr>(a, int64_t(0));
+}
+static_assert(obf_test_lib_constexpr() == 84);
+
+//obf_dump_*(): values are written as they would be in a memory dump, and decoder output is compared with the expected one
+using ObfTestDumpT = OBFI3(uint32_t);
+ITHARE_OBF_DUMP_TYPE(obftest_dump, ObfTestDumpT);
+template<class F>
+std::string obf_test_capture_cout(F f) {
+	std::ostringstream out;
+	std::streambuf* old = std::cout.rdbuf(out.rdbuf());
+	f();
+	std::cout.rdbuf(old);
+	return out.str();
+}
+
+//ITHARE_OBF_LOG(): logged into tmpfile(), then decoded back
+ITHARE_OBF_NOINLINE void obf_test_log(OBFI3(uint32_t) gold, OBFI3(int64_t) delta) {
+	ITHARE_OBF_LOG("gold={} delta={}", gold, delta);
+	ITHARE_OBF_LOG("no args");
+}
+inline std::string obf_test_read_all(FILE* f) {
+	std::string ret;
+	rewind(f);
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		ret.append(buf, n);
+	return ret;
+}
+inline bool obf_test_log_decode(const std::string& raw, std::string& out) {
+	std::istringstream in(raw);
+	std::ostringstream os;
+	bool ok = ITOBF obf_log_decode(in, os);
+	out = os.str();
+	return ok;
+}
+
+//obf_delta_*(): encode(prev,cur) then apply(prev) MUST give cur
+inline bool obf_test_delta_roundtrip(const std::vector<uint8_t>& prev, const std::vector<uint8_t>& cur) {
+	std::vector<uint8_t> delta;
+	ITOBF obf_delta_encode(prev.data(), cur.data(), cur.size(), delta);
+	std::vector<uint8_t> applied = prev;
+	return ITOBF obf_delta_apply(applied.data(), applied.size(), delta.data(), delta.size()) && applied == cur;
+}
+
+//obf_config_load*(): parse results, range checks, malformed input, and wiping
+struct ObfTestConfig {
+	OBFI3(uint32_t) speed_cap;
+	OBFI3(int32_t) cooldown;
+	OBFI2(uint8_t) level;
+	OBFI3(uint64_t) gold;
+};
+static const ITOBF ObfConfigField<ObfTestConfig> obf_test_config_fields[] = {
+	ITHARE_OBF_CONFIG_FIELD(ObfTestConfig,speed_cap),
+	ITHARE_OBF_CONFIG_FIELD(ObfTestConfig,cooldown),
+	ITHARE_OBF_CONFIG_FIELD_NAMED(ObfTestConfig,level,"stats.level"),
+	ITHARE_OBF_CONFIG_FIELD(ObfTestConfig,gold),
+};
+inline bool obf_test_config_load(const std::string& json, ObfTestConfig& cfg) {
+	return ITOBF obf_config_load(json.c_str(), json.size(), cfg, obf_test_config_fields);
+}
+
+//ObfStruct<>: hot fields go first, and all fields keep their values
+struct obf_test_a; struct obf_test_b; struct obf_test_c; struct obf_test_d; struct obf_test_e;
+#define OBF_TEST_STRUCT_FIELDS ITOBF ObfField<obf_test_a, OBFI3(uint32_t), true>, ITOBF ObfField<obf_test_b, OBFI3(uint64_t)>, \
+	ITOBF ObfField<obf_test_c, OBFI3(uint8_t), true>, ITOBF ObfField<obf_test_d, char[10]>, ITOBF ObfField<obf_test_e, OBFI3(uint64_t), true>
+using ObfTestStructSourceOrder = ITOBF ObfStruct<0, OBF_TEST_STRUCT_FIELDS>;
+using ObfTestStructSeed1 = ITOBF ObfStruct<0x1234'5678, OBF_TEST_STRUCT_FIELDS>;
+using ObfTestStructSeed2 = ITOBF ObfStruct<0x8765'4321'0000, OBF_TEST_STRUCT_FIELDS>;
+using ObfTestStruct = ITHARE_OBF_STRUCT(ObfTestStruct,OBF_TEST_STRUCT_FIELDS);
+static_assert(std::is_same<ITHARE_OBF_STRUCT(ObfTestStruct,OBF_TEST_STRUCT_FIELDS), ObfTestStruct>::value);//layout depends on tag, not on the place where the type is spelled
+static_assert(ITOBF obf_tag_hash("ObfTestStruct") != ITOBF obf_tag_hash("ObfTestStruct2"));
+template<class S>
+bool obf_test_struct_layout() {
+	size_t hot[] = { S::template offset_of<obf_test_a>(), S::template offset_of<obf_test_c>(), S::template offset_of<obf_test_e>() };
+	size_t cold[] = { S::template offset_of<obf_test_b>(), S::template offset_of<obf_test_d>() };
+	bool hot_first = true;
+	for (size_t h : hot)
+		for (size_t c : cold)
+			hot_first = hot_first && h < c;
+	S s;
+	s.template get<obf_test_a>() = 1;
+	s.template get<obf_test_b>() = 2;
+	s.template get<obf_test_c>() = 3;
+	s.template get<obf_test_d>()[9] = 4;
+	s.template get<obf_test_e>() = 5;
+	return hot_first && s.template get<obf_test_a>() == 1 && s.template get<obf_test_b>() == 2 && s.template get<obf_test_c>() == 3 && 
+		s.template get<obf_test_d>()[9] == 4 && s.template get<obf_test_e>() == 5 && s.template get<obf_test_d>()[0] == 0;
+}
+
 #ifdef __GNUC__ //warnings in lest.hpp - can only disable :-(
 #pragma GCC diagnostic push
 #ifdef __clang__
@@ -90,6 +240,452 @@ const lest::test module[] = {
 		EXPECT( factorial(20) == UINT64_C(2432902008176640000));
 		EXPECT( factorial(21) == UINT64_C(14197454024290336768));//with wrap-around(!)
 	},
+	CASE("obf::OBFS?L_COLD()",) {
+		EXPECT(obf_test_cold_check(5) == 5);
+		std::string msg, msg_inline;
+		try { obf_test_cold_check(-1); }
+		catch (const MyException& e) { msg = e.what(); }
+		//NB: expected strings are obfuscated too, otherwise obfleakscan would find them in plaintext
+		EXPECT(msg == std::string(OBFS2L("Negative argument to obf_test_cold_check!")));
+		try { factorial(-1); }
+		catch (const MyException& e) { msg_inline = e.what(); }
+		EXPECT(msg_inline == std::string(OBFS2L("Negative argument to factorial!")));
+	},
+	CASE("obf::obf_ct_equal()/obf_ct_compare()",) {//timing is measured by obfbench, as wall-clock ratios are too noisy for a unit test
+		std::vector<OBFI3(uint32_t)> a(NCTELEMS), early(NCTELEMS), late(NCTELEMS);
+		for (size_t i = 0; i < NCTELEMS; ++i)
+			a[i] = early[i] = late[i] = uint32_t(i);
+		early[0] = 12345678;
+		late[NCTELEMS-1] = 12345678;
+		EXPECT(ITOBF obf_ct_equal(a.data(), a.data(), NCTELEMS));
+		EXPECT(!ITOBF obf_ct_equal(a.data(), early.data(), NCTELEMS));
+		EXPECT(!ITOBF obf_ct_equal(a.data(), late.data(), NCTELEMS));
+		EXPECT(ITOBF obf_ct_compare(a.data(), early.data(), NCTELEMS) == -1);
+		EXPECT(ITOBF obf_ct_compare(late.data(), a.data(), NCTELEMS) == 1);
+		EXPECT(ITOBF obf_ct_compare(a.data(), a.data(), NCTELEMS) == 0);
+	},
+	CASE("obf::obf_lib algorithms",) {
+		OBFI3(int32_t) a[8];
+		ITOBF obf_fill_n(a, 8, -3);
+		EXPECT(ITOBF obf_count_n(a, 8, -3) == 8);
+		for (int i = 0; i < 8; ++i)
+			a[i] = i * 5 - 7;
+		EXPECT(ITOBF obf_find_n(a, 8, 13) == 4);
+		EXPECT(ITOBF obf_find_n(a, 8, 14) == 8);
+		EXPECT(ITOBF obf_accumulate_n(a, 8, int64_t(0)) == 84);
+		auto mm = ITOBF obf_minmax_n(a, 8);
+		EXPECT(mm.first == -7);
+		EXPECT(mm.second == 28);
+		ITOBF obf_reverse_n(a, 8);
+		EXPECT(a[0] == 28);
+		EXPECT(a[7] == -7);
+	},
+	CASE("obf::obf_lib.h wrappers",) {
+		OBFI3(int32_t) a[8];
+		ITOBF obf_fill<0>(a, -3);
+		EXPECT(ITOBF obf_count<0>(a, -3) == 8);
+		for (int i = 0; i < 8; ++i)
+			a[i] = i * 5 - 7;
+		EXPECT(ITOBF obf_find<0>(a, 13) == 4);
+		EXPECT(ITOBF obf_find<0>(a, 14) == 8);
+		EXPECT(ITOBF obf_accumulate<0>(a, int64_t(0)) == 84);
+		auto mm = ITOBF obf_minmax<0>(a);
+		EXPECT(mm.first == -7);
+		EXPECT(mm.second == 28);
+		ITOBF obf_reverse<0>(a);
+		EXPECT(a[0] == 28);
+		EXPECT(a[7] == -7);
+		EXPECT(obf_test_lib_constexpr() == 84);//constexpr versions, evaluated at runtime
+	},
+	CASE("obf::obf_par_*() results are identical to serial ones",) {
+		constexpr size_t n = 1'000'003;//several chunks, odd size
+		std::vector<OBFI3(int32_t)> a(n);
+		for (size_t i = 0; i < n; ++i)
+			a[i] = int32_t(i * 2654435761u % 2001) - 1000;
+		ITOBF ObfThreadPool pool(4);
+		EXPECT(ITOBF obf_par_accumulate_n(pool, a.data() + 1, n - 1, int64_t(0)) == ITOBF obf_accumulate_n(a.data() + 1, n - 1, int64_t(0)));
+		EXPECT(ITOBF obf_par_count_n(pool, a.data(), n, 17) == ITOBF obf_count_n(a.data(), n, 17));
+		EXPECT(ITOBF obf_par_find_n(pool, a.data(), n, 999) == ITOBF obf_find_n(a.data(), n, 999));
+		EXPECT(ITOBF obf_par_minmax_n(pool, a.data(), n) == ITOBF obf_minmax_n(a.data(), n));
+		std::vector<OBFI3(int32_t)> r = a;
+		ITOBF obf_par_reverse_n(pool, r.data(), n);
+		ITOBF obf_reverse_n(a.data(), n);
+		EXPECT(ITOBF obf_ct_equal(a.data(), r.data(), n));
+		std::vector<OBFI4(int32_t)> t(n);
+		ITOBF obf_par_transcode_n(pool, a.data(), t.data(), n);
+		EXPECT(ITOBF obf_ct_equal(a.data(), t.data(), n));
+	},
+	CASE("obf::obf_crc32c()/obf_xxh32() over encoded data",) {
+		EXPECT(ITOBF obf_crc32c_bytes("123456789", 9) == UINT32_C(0xE3069283));
+		EXPECT(ITOBF obf_xxh32_bytes("abc", 3) == UINT32_C(0x32D153FF));
+		for (size_t n = 0; n < 40; ++n) {
+			std::vector<uint16_t> plain(n);
+			std::vector<OBFI3(uint16_t)> encoded(n);
+			for (size_t i = 0; i < n; ++i)
+				encoded[i] = plain[i] = uint16_t(i * 40503u);
+			EXPECT(ITOBF obf_crc32c(encoded.data(), n, 1) == ITOBF obf_crc32c_bytes(plain.data(), n * 2, 1));
+			EXPECT(ITOBF obf_xxh32(encoded.data(), n, 2) == ITOBF obf_xxh32_bytes(plain.data(), n * 2, 2));
+		}
+	},
+	CASE("obf::ObfRng<> is xoshiro256**",) {
+		//known answers: outputs #1..#4 and #1000 of reference xoshiro256** (xoshiro256starstar.c), 
+		//  with state filled by 4 consecutive calls to reference splitmix64.c next() seeded with the same seed
+		struct { uint64_t seed; uint64_t first[4]; uint64_t nr1000; } kat[] = {
+			{ 0, { UINT64_C(0x99ec'5f36'cb75'f2b4), UINT64_C(0xbf6e'1f78'4956'452a), UINT64_C(0x1a5f'849d'4933'e6e0), UINT64_C(0x6aa5'94f1'262d'2d2c) }, UINT64_C(0x7aac'8c48'3a2e'dd2f) },
+			{ 12345, { UINT64_C(0xbe6a'3637'4160'd49b), UINT64_C(0x214a'aa06'37a6'88c6), UINT64_C(0xf69d'16de'9954'd388), UINT64_C(0x0c60'048c'4e96'e033) }, UINT64_C(0x3cbb'8486'5296'94b8) },
+		};
+		for (auto& k : kat) {
+			ITOBF ObfRng<OBFI3(uint64_t)> rng(k.seed);
+			for (int i = 0; i < 4; ++i)
+				EXPECT(rng() == k.first[i]);
+			uint64_t r = 0;
+			for (int i = 4; i < 1000; ++i)
+				r = rng();
+			EXPECT(r == k.nr1000);
+		}
+		ITOBF ObfRng<OBFI3(uint64_t)> rng1(7), rng2(7);
+		OBFI2(uint64_t) batch[10];
+		rng1.generate(batch, 10);
+		for (int i = 0; i < 10; ++i)
+			EXPECT(batch[i] == rng2());
+	},
+	CASE("obf::ObfArena",) {
+		struct Entity { OBFI3(uint32_t) hp; OBFI3(uint64_t) gold; OBFI3(uint8_t) level; };
+		ITOBF ObfArena arena(4096, 256, 0x1234'5678);
+		for (int frame = 0; frame < 3; ++frame) {
+			std::vector<Entity*> all;
+			bool no_straddle = true;
+			for (uint32_t i = 0; i < 1000; ++i) {
+				Entity* e = arena.create<Entity>();
+				e->hp = i;
+				uintptr_t p = reinterpret_cast<uintptr_t>(e);
+				no_straddle = no_straddle && (p / ITOBF obf_cache_line == (p + sizeof(Entity) - 1) / ITOBF obf_cache_line);
+				all.push_back(e);
+			}
+			EXPECT(no_straddle);
+			bool intact = true;
+			for (uint32_t i = 0; i < 1000; ++i)
+				intact = intact && all[i]->hp == i;
+			EXPECT(intact);
+			size_t nchunks = arena.nchunks();
+			arena.reset();
+			EXPECT(arena.nchunks() == nchunks);//chunks are reused
+		}
+
+		//oversized and overaligned requests fail deterministically, without affecting the arena
+		size_t nchunks = arena.nchunks();
+		EXPECT(arena.allocate(257, 8) == nullptr);
+		EXPECT(arena.allocate(8, 2 * ITOBF obf_cache_line) == nullptr);
+		struct Big { uint8_t data[300]; };
+		EXPECT(arena.create<Big>() == nullptr);
+		EXPECT(arena.allocate(256, 8) != nullptr);
+		EXPECT(arena.nchunks() == nchunks);
+
+		//all stripes of a chunk are used exactly once per pass, whatever the order
+		ITOBF ObfArena one(4096, 256, 0x8765'4321);
+		for (int frame = 0; frame < 3; ++frame) {
+			std::vector<uintptr_t> stripes;
+			for (int i = 0; i < 16; ++i)
+				stripes.push_back(reinterpret_cast<uintptr_t>(one.allocate(256, 8)) / 256);
+			std::sort(stripes.begin(), stripes.end());
+			EXPECT(std::unique(stripes.begin(), stripes.end()) == stripes.end());
+			EXPECT(one.nchunks() == 1);
+			one.reset();
+		}
+	},
+	CASE("obf::ObfMulInt<> factorial and dot product",) {
+		using M = ITOBF ObfMulInt<uint64_t,UINT64_C(0x1234'5678'9abc'def1)>;
+		EXPECT(M::C != 1);
+		M ret = 1;
+		for (uint64_t i = 1; i <= 21; ++i)
+			ret *= i;
+		EXPECT(ret.encoded() != ret.value());
+		EXPECT(ret.value() == UINT64_C(14197454024290336768));//with wrap-around(!)
+		M ret2 = 1;
+		for (M i = 1; i != M(22); ++i)
+			ret2 *= i;//encoded*encoded
+		EXPECT(ret2 == ret);
+
+		M a[5] = { 1, 2, 3, 4, 5 };
+		uint64_t b[5] = { 6, 7, 8, 9, 10 };
+		M bm[5] = { 6, 7, 8, 9, 10 };
+		EXPECT(ITOBF obf_mul_dot_n(a, b, 5).value() == 130);
+		EXPECT(ITOBF obf_mul_dot_n(a, bm, 5).value() == 130);
+
+		using M16 = ITOBF ObfMulInt<int16_t,17>;
+		M16 s = -300;
+		s *= int16_t(-200);
+		EXPECT(s.value() == int16_t(uint16_t(60000)));
+		EXPECT((M16(-5) + M16(3)).value() == -2);
+
+		//encoding depends on tag, not on the place where the type is spelled
+		using MT = ITHARE_OBF_MUL_INT(uint32_t,obftest_mul);
+		static_assert(std::is_same<MT, ITHARE_OBF_MUL_INT(uint32_t,obftest_mul)>::value);
+		MT x = 6;
+		x *= MT(7);
+		EXPECT(x.value() == 42);
+	},
+	CASE("obf::ObfDivisor<>",) {
+		bool ok = true;
+		for (unsigned d = 1; d < 256; ++d) {//exhaustive for uint8_t
+			ITOBF ObfDivisor<OBFI3(uint8_t)> dv{uint8_t(d)};
+			for (unsigned x = 0; x < 256; ++x)
+				ok = ok && dv.div(uint8_t(x)) == x / d && dv.mod(uint8_t(x)) == x % d;
+		}
+		EXPECT(ok);
+		uint64_t d64[] = { 1, 2, 3, 7, 1000, UINT64_C(0x8000'0000'0000'0000), UINT64_C(0x8000'0000'0000'0001), ~UINT64_C(0) };
+		uint64_t x64[] = { 0, 1, 999, 1000, UINT64_C(0x1234'5678'9abc'def0), UINT64_C(0x8000'0000'0000'0000), ~UINT64_C(0) };
+		for (uint64_t d : d64) {
+			ITOBF ObfDivisor<OBFI3(uint64_t)> dv{d};
+			for (uint64_t x : x64)
+				ok = ok && dv.div(x) == x / d && dv.mod(OBFI3(uint64_t)(x)) == x % d;
+		}
+		EXPECT(ok);
+
+		ITOBF ObfDivisor<OBFI3(uint32_t)> w(37);
+		OBFI3(uint32_t) idx[100];
+		uint32_t row[100];
+		OBFI3(uint32_t) col[100];
+		for (uint32_t i = 0; i < 100; ++i)
+			idx[i] = i * 11;
+		ITOBF obf_divmod_n(idx, 100, w, row, col);
+		for (uint32_t i = 0; i < 100; ++i)
+			ok = ok && row[i] == i * 11 / 37 && uint32_t(col[i]) == i * 11 % 37;
+		EXPECT(ok);
+		w.set(1);
+		EXPECT(w.divisor() == 1);
+		EXPECT(w.div(uint32_t(12345)) == 12345);
+	},
+	CASE("obf::obf_dump_decode()/obf_dump_find()",) {
+		const ITOBF ObfDumpTypeDescr* t = ITOBF ObfDumpRegistry<void>::find("obftest_dump");
+		EXPECT(t != nullptr);
+		if (!t)
+			return;
+		EXPECT(t->size == sizeof(ObfTestDumpT));
+		uint32_t plain[6] = { 7, 1000, 0xdead'beef, 1000, 0, 0xffff'ffff };
+		ObfTestDumpT vals[6];
+		for (int i = 0; i < 6; ++i)
+			vals[i] = plain[i];
+		FILE* f = tmpfile();
+		EXPECT(f != nullptr);
+		if (!f)
+			return;
+		const size_t sz = sizeof(ObfTestDumpT);
+		for (size_t i = 0; i < sz; ++i)
+			fputc(0x5a, f);//junk before the values, as in a real dump
+		EXPECT(fwrite(vals, sz, 6, f) == 6);
+		fflush(f);
+		
+		std::ostringstream expected;
+		for (size_t i = 1; i < 6; ++i)
+			expected << "0x" << std::hex << ((1 + i) * sz) << std::dec << " " << plain[i] << '\n';
+		std::string got = obf_test_capture_cout([&]() { EXPECT(ITOBF obf_dump_decode(f, *t, 2 * sz, 100) == 0); });//reading past EOF just stops
+		EXPECT(got == expected.str());
+
+		std::ostringstream hit1, hit3;
+		hit1 << "0x" << std::hex << (2 * sz) << '\n';
+		hit3 << "0x" << std::hex << (4 * sz) << '\n';
+		rewind(f);
+		got = obf_test_capture_cout([&]() { EXPECT(ITOBF obf_dump_find(f, *t, 1000, sz) == 0); });
+		EXPECT(got == hit1.str() + hit3.str());
+		rewind(f);
+		got = obf_test_capture_cout([&]() { EXPECT(ITOBF obf_dump_find(f, *t, 1000, 1) == 0); });//MAY find matches spanning adjacent words too
+		EXPECT(got.find(hit1.str()) != std::string::npos);
+		EXPECT(got.find(hit3.str()) != std::string::npos);
+		fclose(f);
+	},
+	CASE("obf::obf_log() and obf_log_decode()",) {
+		FILE* f = tmpfile();
+		EXPECT(f != nullptr);
+		if (!f)
+			return;
+		ITOBF obf_log_set_sink(f);
+		obf_test_log(5, -3);
+		for (uint32_t i = 0; i < 10000; ++i)//more than one buffer
+			obf_test_log(i, int64_t(i) - 5000);
+		ITOBF obf_log_flush();
+		ITOBF obf_log_set_sink(nullptr);
+		std::string raw = obf_test_read_all(f);
+		fclose(f);
+
+		std::string out;
+		EXPECT(obf_test_log_decode(raw, out));
+		EXPECT(out.find("] gold=5 delta=-3\n") != std::string::npos);
+		EXPECT(out.find("] gold=9999 delta=4999\n") != std::string::npos);
+		EXPECT(out.find("] no args\n") != std::string::npos);
+		EXPECT(std::count(out.begin(), out.end(), '\n') == 2 * 10001);
+		
+		//unknown site: well-formed block, with the record from a site which the decoder doesn't know
+		uint32_t hdr[3] = { ITOBF obf_log_block_magic, 1, 6 };
+		uint32_t site = ITOBF obf_log_site_id("no_such_file.cpp", 1);
+		uint16_t psz = 0;
+		std::string unknown(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+		unknown.append(reinterpret_cast<const char*>(&site), 4);
+		unknown.append(reinterpret_cast<const char*>(&psz), 2);
+		EXPECT(!obf_test_log_decode(unknown, out));
+		EXPECT(out.find("<unknown site") != std::string::npos);
+
+		//truncated block
+		EXPECT(!obf_test_log_decode(raw.substr(0, raw.size() - 1), out));
+		//record which doesn't fit into its block
+		psz = 1;
+		std::string overrun(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+		overrun.append(reinterpret_cast<const char*>(&site), 4);
+		overrun.append(reinterpret_cast<const char*>(&psz), 2);
+		EXPECT(!obf_test_log_decode(overrun, out));
+	},
+	CASE("obf::obf_persist_save()/obf_persist_load()",) {
+		OBFI3(uint32_t) u[100], u2[100];
+		OBFI3(int64_t) l[100], l2[100];
+		OBFI2(uint8_t) b[100], b2[100];
+		for (uint32_t i = 0; i < 100; ++i) {
+			u[i] = i * 40503u;
+			l[i] = int64_t(i) * -1234567891011;
+			b[i] = uint8_t(i * 3);
+		}
+		uint8_t su[100 * 4], sl[100 * 8], sb[100];
+		ITOBF obf_persist_save(u, 100, su);
+		ITOBF obf_persist_save(l, 100, sl);
+		ITOBF obf_persist_save(b, 100, sb);
+		ITOBF obf_persist_load(su, 100, u2);
+		ITOBF obf_persist_load(sl, 100, l2);
+		ITOBF obf_persist_load(sb, 100, b2);
+		bool same = true;
+		for (int i = 0; i < 100; ++i)
+			same = same && uint32_t(u2[i]) == uint32_t(u[i]) && int64_t(l2[i]) == int64_t(l[i]) && uint8_t(b2[i]) == uint8_t(b[i]);
+		EXPECT(same);
+
+		//explicit key: stored form is NOT plain
+		uint8_t su1[100 * 4];
+		ITOBF obf_persist_save<0x1234>(u, 100, su1);
+		EXPECT(memcmp(su1, su, sizeof(su)) != 0 || ITOBF obf_persist_default_key == 0x1234);
+		ITOBF obf_persist_load<0x1234>(su1, 100, u2);
+		same = true;
+		for (int i = 0; i < 100; ++i)
+			same = same && uint32_t(u2[i]) == uint32_t(u[i]);
+		EXPECT(same);
+	},
+	CASE("obf::obf_persist_load_blob() rejects wrong key and corrupted blobs",) {
+		OBFI3(uint32_t) u[100], u2[100];
+		for (uint32_t i = 0; i < 100; ++i) {
+			u[i] = i * 40503u;
+			u2[i] = 7;
+		}
+		constexpr size_t blobsz = ITOBF obf_persist_blob_size<OBFI3(uint32_t)>(100);
+		uint8_t blob[blobsz];
+		ITOBF obf_persist_save_blob<0x1234>(u, 100, blob);
+		EXPECT(!ITOBF obf_persist_load_blob<0x4321>(blob, blobsz, 100, u2));//wrong key
+		EXPECT(!ITOBF obf_persist_load_blob<0x1234>(blob, blobsz - 1, 100, u2));//truncated
+		EXPECT(!ITOBF obf_persist_load_blob<0x1234>(blob, blobsz, 99, u2));//wrong n
+		blob[blobsz / 2] ^= 0x10;
+		EXPECT(!ITOBF obf_persist_load_blob<0x1234>(blob, blobsz, 100, u2));//corrupted
+		EXPECT(uint32_t(u2[1]) == 7);//rejected blobs leave values untouched
+		blob[blobsz / 2] ^= 0x10;
+		EXPECT(ITOBF obf_persist_load_blob<0x1234>(blob, blobsz, 100, u2));
+		bool same = true;
+		for (int i = 0; i < 100; ++i)
+			same = same && uint32_t(u2[i]) == uint32_t(u[i]);
+		EXPECT(same);
+	},
+	CASE("obf::obf_delta_encode()/obf_delta_apply()",) {
+		for (size_t size : { size_t(0), size_t(3), size_t(4), size_t(1001), size_t(4096), size_t(4099) }) {
+			std::vector<uint8_t> prev(size), cur(size);
+			for (size_t i = 0; i < size; ++i)
+				prev[i] = cur[i] = uint8_t(i * 7);
+			EXPECT(obf_test_delta_roundtrip(prev, cur));//unchanged
+			if (!size)
+				continue;
+			cur[0] ^= 1;
+			cur[size - 1] ^= 0x80;//trailing partial word, if any
+			EXPECT(obf_test_delta_roundtrip(prev, cur));
+			for (size_t i = size / 3; i < size / 3 + 600 && i < size; ++i)//ndiff > 127 words => multi-byte varint
+				cur[i] ^= 0x5a;
+			EXPECT(obf_test_delta_roundtrip(prev, cur));
+			for (size_t i = 0; i < size; ++i)
+				cur[i] = uint8_t(~prev[i]);//everything changed
+			EXPECT(obf_test_delta_roundtrip(prev, cur));
+		}
+		std::vector<uint8_t> prev(4096), cur(4096);
+		cur[2000] = 1;//nskip > 127 words => multi-byte varint
+		EXPECT(obf_test_delta_roundtrip(prev, cur));
+		std::vector<uint8_t> delta;
+		ITOBF obf_delta_encode(prev.data(), cur.data(), cur.size(), delta);
+		EXPECT(delta.size() < 16);
+
+		std::vector<uint8_t> applied = prev;
+		EXPECT(!ITOBF obf_delta_apply(applied.data(), applied.size(), delta.data(), delta.size() - 1));//truncated
+		EXPECT(!ITOBF obf_delta_apply(applied.data(), 1000, delta.data(), delta.size()));//delta doesn't fit snapshot
+		uint8_t huge[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01, 0x00 };//varint over 64 bits
+		EXPECT(!ITOBF obf_delta_apply(applied.data(), applied.size(), huge, sizeof(huge)));
+		uint8_t toomany[] = { 0x00, 0xff, 0x7f, 0x00, 0x00, 0x00, 0x00 };//ndiff=16383 words, with data for one
+		EXPECT(!ITOBF obf_delta_apply(applied.data(), applied.size(), toomany, sizeof(toomany)));
+		uint8_t partial[] = { 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x10 };//good first run, then second one without ndiff
+		EXPECT(!ITOBF obf_delta_apply(applied.data(), applied.size(), partial, sizeof(partial)));
+		EXPECT(applied == prev);//rejected deltas leave snapshot untouched
+	},
+	CASE("obf::obf_config_load()",) {
+		ObfTestConfig cfg;
+		EXPECT(obf_test_config_load("{ \"name\": \"x\\\"y\", \"speed_cap\": 4000000000, \"cooldown\": -2147483648,\n"
+			"\"tags\": [1, {\"a\": \"]\"}], \"stats\": { \"level\": 255, \"hp\": 1.5 }, \"gold\": 18446744073709551615, \"ok\": true }", cfg));
+		EXPECT(uint32_t(cfg.speed_cap) == 4000000000u);
+		EXPECT(int32_t(cfg.cooldown) == INT32_MIN);
+		EXPECT(uint8_t(cfg.level) == 255);
+		EXPECT(uint64_t(cfg.gold) == UINT64_MAX);
+		EXPECT(obf_test_config_load(" {} ", cfg));
+		
+		//out of range
+		EXPECT(!obf_test_config_load("{\"stats\": {\"level\": 256}}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": -1}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": 4294967296}", cfg));
+		EXPECT(!obf_test_config_load("{\"cooldown\": 2147483648}", cfg));
+		EXPECT(!obf_test_config_load("{\"cooldown\": -2147483649}", cfg));
+		EXPECT(!obf_test_config_load("{\"gold\": 18446744073709551616}", cfg));
+		//malformed
+		EXPECT(!obf_test_config_load("{\"speed_cap\": 1.5}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": 1e3}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": -}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": \"1\"}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\" 1}", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": 1", cfg));
+		EXPECT(!obf_test_config_load("{\"speed_cap\": 1} x", cfg));
+		EXPECT(!obf_test_config_load("{\"name\": \"unterminated}", cfg));
+		EXPECT(!obf_test_config_load("{\"tags\": [1, 2}", cfg));
+		EXPECT(!obf_test_config_load("", cfg));
+	},
+	CASE("obf::obf_config_load() wipes numbers, obf_config_load_array()",) {
+		std::string json = "[{\"speed_cap\": 123, \"name\": \"u1\"}, {\"speed_cap\": 456, \"cooldown\": -78, \"gold\": 9}]";
+		std::string orig = json;
+		std::vector<ObfTestConfig> cfgs;
+		EXPECT(ITOBF obf_config_load_array(json.c_str(), json.size(), cfgs, obf_test_config_fields));//const buffer: not wiped
+		EXPECT(json == orig);
+		EXPECT(cfgs.size() == 2);
+		EXPECT(uint32_t(cfgs[1].speed_cap) == 456);
+		EXPECT(int32_t(cfgs[1].cooldown) == -78);
+		cfgs.clear();
+		EXPECT(ITOBF obf_config_load_array(&json[0], json.size(), cfgs, obf_test_config_fields));//non-const buffer: wiped
+		EXPECT(json == "[{\"speed_cap\":    , \"name\": \"u1\"}, {\"speed_cap\":    , \"cooldown\":    , \"gold\":  }]");
+		EXPECT(cfgs.size() == 2);
+		EXPECT(uint32_t(cfgs[0].speed_cap) == 123);
+		EXPECT(uint64_t(cfgs[1].gold) == 9);
+
+		std::string one = "{\"stats\": {\"level\": 7}}";
+		ObfTestConfig cfg;
+		EXPECT(ITOBF obf_config_load(&one[0], one.size(), cfg, obf_test_config_fields));
+		EXPECT(one == "{\"stats\": {\"level\":  }}");
+		EXPECT(uint8_t(cfg.level) == 7);
+		std::string bad = "{\"speed_cap\": 99999999999}";
+		EXPECT(!ITOBF obf_config_load(&bad[0], bad.size(), cfg, obf_test_config_fields));
+		EXPECT(bad == "{\"speed_cap\":            }");//out-of-range number is wiped too
+		bad = "{\"gold\": 123456789012345678901234}";
+		EXPECT(!ITOBF obf_config_load(&bad[0], bad.size(), cfg, obf_test_config_fields));
+		EXPECT(bad == "{\"gold\":                         }");//so is the one which doesn't fit into 64 bits
+	},
+	CASE("obf::ObfStruct<> layout",) {
+		EXPECT(obf_test_struct_layout<ObfTestStructSourceOrder>());
+		EXPECT(obf_test_struct_layout<ObfTestStructSeed1>());
+		EXPECT(obf_test_struct_layout<ObfTestStructSeed2>());
+		EXPECT(obf_test_struct_layout<ObfTestStruct>());
+	},
 };
 
 /* TODO - a test case out of it
@@ -114,7 +710,13 @@ int main(int argc, char** argv) {
 #pragma GCC diagnostic pop
 #endif
 
+}//namespace obftest
 
 extern lest::tests& specification();
 
-MODULE( specification(), module )
+MODULE( specification(), obftest::module )
+
+#undef ITOBF
+#undef NBENCH
+#undef NCTELEMS
+#undef OBF_TEST_STRUCT_FIELDS
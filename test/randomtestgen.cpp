@@ -43,6 +43,8 @@ inline bool starts_with(std::string a,std::string b) {
 
 class ObfTestEnvironment : public KscopeTestEnvironment {
 	public:
+	bool unity = false;//-unity: one TU per configuration instead of one per test source
+
 	virtual std::string test_src_dir() override { return  src_dir_prefix + "../../../kscope/test/"; }
 	//virtual std::string file_list() override { return KscopeTestEnvironment::file_list() + make_file_list(obf_randomtest_files,src_dir_prefix); }
 
@@ -60,14 +62,61 @@ class ObfTestEnvironment : public KscopeTestEnvironment {
 		else
 			return "";
 	}
+
+	//UNITY BUILDS
+	//  obfunity.cpp #includes obftest.cpp first (so that obf.h maps ITHARE_OBF_* into ITHARE_KSCOPE_* before kscope headers are seen), 
+	//    then kscope test sources; ITHARE_OBF_* defines are used where mapping exists, ITHARE_KSCOPE_* ones otherwise
+	//  ODR/static-name clashes: obftest.cpp keeps its names in namespace obftest and #undef's its macros at the end
+	std::vector<std::string> unity_sources() {
+		std::vector<std::string> ret;
+		std::string all = make_file_list(obf_randomtest_files,src_dir_prefix) + " " + KscopeTestEnvironment::file_list();
+		size_t pos = 0;
+		while(pos < all.size()) {
+			size_t b = all.find_first_not_of(' ',pos);
+			if(b == std::string::npos)
+				break;
+			size_t e = all.find(' ',b);
+			if(e == std::string::npos)
+				e = all.size();
+			ret.push_back(all.substr(b,e-b));
+			pos = e;
+		}
+		return ret;
+	}
+	std::string unity_defines(const MultiString& defines, const char* dopt) {
+		std::string ret;
+		for(std::string s:defines) {
+			if(obf_define(s)!="")
+				ret += std::string(" ") + dopt + obf_define(s);
+			else
+				ret += std::string(" ") + dopt + "ITHARE_KSCOPE_" + s;
+		}
+		return ret;
+	}
+
 #ifdef __GNUC__ //includes clang
+	//-pthread: obftest.cpp starts threads (ObfThreadPool), and glibc before 2.34 needs it for std::thread at runtime
 #ifdef __apple_build_version__
-	static constexpr const char* lopt_extra ="";//no -latomic needed or possible for Apple Clang
+	static constexpr const char* lopt_extra =" -pthread";//no -latomic needed or possible for Apple Clang
 #else
-	static constexpr const char* lopt_extra = " -latomic";
+	static constexpr const char* lopt_extra = " -pthread -latomic";
 #endif
 
+	MultiString build_unity(MultiString defines,std::string opts,std::string compiler_options,std::string linker_options) {
+		std::string gen = "printf '#include \"%s\"\\n'";
+		for(std::string f:unity_sources())
+			gen += " " + f;
+		gen += " >obfunity.cpp";
+		return MultiString{
+			gen,
+			"$CXX -c" + compiler_options + " -DITHARE_KSCOPE_TEST_EXTENSION=\"../../obf/src/kscope_extension_for_obf.h\"" + unity_defines(defines,"-D") + opts + " obfunity.cpp",
+			"$CXX" + linker_options + lopt_extra + opts + " obfunity.o"
+			};
+	}
+
 	virtual MultiString build_release(MultiString defines,std::string opts) override {
+		if(unity)
+			return build_unity(defines,opts,compiler_options_release(),linker_options_release());
 		std::string kscopedefs = "";
 		std::string obfdefs = "";
 		for(std::string s:defines) {
@@ -86,6 +135,8 @@ class ObfTestEnvironment : public KscopeTestEnvironment {
 			};
 	}
 	virtual MultiString build_debug(MultiString defines,std::string opts) override {
+		if(unity)
+			return build_unity(defines,opts,compiler_options_debug(),linker_options_debug());
 		std::string kscopedefs = "";
 		std::string obfdefs = "";
 		for(std::string s:defines) {
@@ -104,7 +155,21 @@ class ObfTestEnvironment : public KscopeTestEnvironment {
 			};
 	}
 #elif defined(_MSC_VER)
+	MultiString build_unity(MultiString defines,std::string opts,std::string compiler_options,std::string linker_options) {
+		MultiString ret;
+		bool first = true;
+		for(std::string f:unity_sources()) {
+			ret.push_back("echo #include \"" + f + "\" " + (first ? ">" : ">>") + "obfunity.cpp");
+			first = false;
+		}
+		ret.push_back("cl /c" + compiler_options + " /DITHARE_KSCOPE_TEST_EXTENSION=\"../../obf/src/kscope_extension_for_obf.h\"" + unity_defines(defines,"/D") + opts + " obfunity.cpp");
+		ret.push_back("cl " + linker_options + opts + " obfunity.obj");
+		return ret;
+	}
+
 	virtual MultiString build_release(MultiString defines,std::string opts) {
+		if(unity)
+			return build_unity(defines,opts,compiler_options_release(),linker_options_release());
 		std::string kscopedefs = "";
 		std::string obfdefs = "";
 		for(std::string s:defines) {
@@ -123,6 +188,8 @@ class ObfTestEnvironment : public KscopeTestEnvironment {
 			};
 	}
 	virtual MultiString build_debug(MultiString defines,std::string opts) {
+		if(unity)
+			return build_unity(defines,opts,compiler_options_debug(),linker_options_debug());
 		std::string kscopedefs = "";
 		std::string obfdefs = "";
 		for(std::string s:defines) {
@@ -142,33 +209,51 @@ class ObfTestEnvironment : public KscopeTestEnvironment {
 	}
 #endif
 	
+	//PLAINTEXT LEAK SCAN (see ../obfleakscan.cpp)
+	//  each obfuscated executable is kept as randomtest-obf-N and listed in obfleakscan.lst; 
+	//    after the session, randomtest.sh/.bat runs leak_scan() (randomtestgen -leakscan) once over all of them,
+	//    with literals harvested from all the test sources (obftest.cpp and kscope's ones)
+	int nobfexe = 0;
+	
+	std::string leak_scan(const char* scanner) {
+		std::string ret = scanner;
+		for(std::string f:unity_sources())
+			ret += " -src " + f;
+		return ret + " -list obfleakscan.lst";
+	}
+
 #if defined(__APPLE_CC__) || defined(__linux__)
 	virtual std::string check_exe(int nseeds,config cfg,Flags flags) override {
 		bool obfuscated = nseeds != 0;
 
-		//automated check: very weak heuristics, but still better than nothing
-		std::string cmp = std::string("strings randomtest | grep \"Negative argument\"");//referring to string "Negative argument to factorial()" 
-		if(flags&flag_auto_dbg_print) {//result is unclear
-			return cmp;
-		}
-		else {
-			cmp += "\n" + exit_check(cmp, !obfuscated);
-			if (obfuscated) {
-				std::string cp = "cp randomtest randomtest-obf";
-				cmp += "\n" + cp + "\n" + exit_check(cp);
-			}
-			return cmp;
+		if(flags&flag_auto_dbg_print)//result is unclear
+			return "";
+		if(!obfuscated) {
+			//sanity check for the scanner itself: literals MUST be found in non-obfuscated executable
+			std::string scan = leak_scan("./obfleakscan");
+			scan = replace_string(scan," -list obfleakscan.lst"," randomtest");
+			return scan + "\n" + exit_check(scan, false);
 		}
+		std::string cp = "cp randomtest randomtest-obf";
+		std::string ret = cp + "\n" + exit_check(cp);
+		std::string keep = "cp randomtest randomtest-obf-" + std::to_string(nobfexe);
+		ret += "\n" + keep + "\n" + exit_check(keep);
+		ret += "\necho randomtest-obf-" + std::to_string(nobfexe) + " >>obfleakscan.lst";
+		++nobfexe;
+		return ret;
 	}
 #elif defined(_MSC_VER)
 	virtual std::string check_exe(int nseeds, config cfg, Flags flags) override {
 		bool obfuscated = nseeds != 0;
-		//no automated check for Windows at the moment :-(
 		if ((flags&flag_auto_dbg_print)==0 && obfuscated & cfg==config::release) {
 			//copying for automated check
 			std::string cp = "copy randomtest.exe randomtest-obf.exe";
-			cp += "\n" + exit_check(cp);
-			return cp;
+			std::string ret = cp + "\n" + exit_check(cp);
+			std::string keep = "copy randomtest.exe randomtest-obf-" + std::to_string(nobfexe) + ".exe";
+			ret += "\n" + keep + "\n" + exit_check(keep);
+			ret += "\necho randomtest-obf-" + std::to_string(nobfexe) + ".exe>>obfleakscan.lst";
+			++nobfexe;
+			return ret;
 		}
 		return "";
 	}
@@ -185,6 +270,30 @@ class ObfTestGenerator : public KscopeTestGenerator {
 
 int main(int argc, char** argv) {
 	ObfTestEnvironment oenv;
+	std::vector<char*> args;//-unity and -leakscan are ours, the rest goes to almost_main()
+	bool leakscan = false;
+	for(int i=0; i < argc; ++i) {
+		if(strcmp(argv[i],"-unity")==0)
+			oenv.unity = true;
+		else if(strcmp(argv[i],"-leakscan")==0)
+			leakscan = true;
+		else
+			args.push_back(argv[i]);
+	}
+	if(leakscan) {//end-of-session scan command over everything listed in obfleakscan.lst
+		for(int i=1; i+1 < argc; ++i)
+			if(strcmp(argv[i],"-srcdirprefix")==0)
+				oenv.src_dir_prefix = argv[i+1];
+#if defined(_MSC_VER)
+		std::string scan = oenv.leak_scan("obfleakscan.exe");
+		std::cout << scan << "\nIF ERRORLEVEL 1 EXIT /B 1" << std::endl;
+#else
+		std::string scan = oenv.leak_scan("./obfleakscan");
+		std::cout << scan << "\nif [ ! $? -eq 0 ]; then\n  exit 1\nfi" << std::endl;
+#endif
+		return 0;
+	}
+	args.push_back(nullptr);
 	ObfTestGenerator ogen(oenv);
-	return almost_main(oenv,ogen,argc,argv);
+	return almost_main(oenv,ogen,int(args.size())-1,args.data());
 }
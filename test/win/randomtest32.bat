@@ -30,6 +30,7 @@
 mkdir runtest32
 cd runtest32
 cl /EHsc advapi32.lib ..\..\randomtestgen.cpp
+cl /EHsc /O2 ..\..\obfleakscan.cpp
 SET NN=%1
 IF NOT .%1 == . GOTO LABEL0
 SET NN=1024
@@ -44,7 +45,31 @@ IF NOT ERRORLEVEL 1 GOTO LABEL1
 EXIT /B
 :LABEL1
 
+DEL /Q randomtest-obf-*.exe obfleakscan.lst 2>NUL
 CALL generatedrandomtest.bat
 
+@REM plaintext leak scan (see obfleakscan.cpp) over all obfuscated executables of the session
+randomtestgen.exe -srcdirprefix ..\ -leakscan >generatedleakscan.bat
+IF ERRORLEVEL 1 EXIT /B
+CALL generatedleakscan.bat
+IF ERRORLEVEL 1 EXIT /B
 
+@REM benchmark results store (see ..\..\obfbenchdb.cpp): obfbench with a fixed seed, OBF_BENCH_RUNS times (0 to skip), 
+@REM   appended to OBF_BENCH_DB; to check for regressions: obfbenchdb.exe compare obfbench.jsonl base-commit new-commit
+IF "%OBF_BENCH_RUNS%" == "" SET OBF_BENCH_RUNS=5
+IF "%OBF_BENCH_DB%" == "" SET OBF_BENCH_DB=obfbench.jsonl
+IF "%OBF_BENCH_RUNS%" == "0" GOTO LABEL_NOBENCH
+SET BENCHSEED=0x4b295ebab3333abc
+SET COMMIT=unknown
+FOR /F %%i IN ('git rev-parse --short HEAD 2^>NUL') DO SET COMMIT=%%i
 
+cl /EHsc /O2 ..\..\obfbenchdb.cpp
+IF ERRORLEVEL 1 EXIT /B
+cl /EHsc /O2 /DNDEBUG /std:c++latest /DITHARE_OBF_SEED=%BENCHSEED% ..\..\obfbench.cpp
+IF ERRORLEVEL 1 EXIT /B
+FOR /L %%i IN (1,1,%OBF_BENCH_RUNS%) DO (
+  obfbench.exe >obfbench-run.txt
+  obfbenchdb.exe append %OBF_BENCH_DB% %COMMIT% %BENCHSEED% "MSVC %VisualStudioVersion%" "/O2 /DNDEBUG" %%i obfbench-run.txt
+)
+DEL obfbench-run.txt
+:LABEL_NOBENCH